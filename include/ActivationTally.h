@@ -0,0 +1,54 @@
+
+#ifndef REST_ACTIVATIONTALLY_H
+#define REST_ACTIVATIONTALLY_H
+
+#include <Rtypes.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+class G4Track;
+
+// Isotopes produced by hadronic interactions (neutron captures included) per volume, counted from the
+// nuclei created as secondaries. Recoils from elastic scattering do not change the nucleus and are not
+// counted. The weighted count is the sum of the track weights. Each thread fills its own counts, they are
+// merged at the end of the run
+class ActivationTally {
+   public:
+    struct Production {
+        Long64_t fCount = 0;
+        Double_t fWeight = 0;
+    };
+
+    // volume (REST name), Z, A, excitation energy (keV)
+    using Isotope = std::tuple<std::string, Int_t, Int_t, Double_t>;
+
+    class Counts {
+       public:
+        // track must be a produced isotope
+        void Fill(const std::string& volume, const G4Track* track);
+
+       private:
+        std::map<Isotope, Production> fProductions;
+
+        friend class ActivationTally;
+    };
+
+    // nucleus created by a non elastic hadronic process
+    static bool IsProducedIsotope(const G4Track* track);
+
+    // Can be called concurrently from several threads
+    void Merge(const Counts& counts);
+
+    // Writes an 'Isotopes' tree, one entry per isotope and volume, into an 'ActivationTally' directory of the
+    // current file
+    void Write();
+
+   private:
+    std::mutex fMutex;
+    std::map<Isotope, Production> fProductions;
+};
+
+#endif  // REST_ACTIVATIONTALLY_H
@@ -15,6 +15,7 @@ struct Options {
     std::string rmlFile{};
     std::string outputFile{};
     std::string geometryFile{};
+    std::string pilotFile{};  // importance map written by a pilot run
 
     bool interactive = false;
 
@@ -26,6 +27,9 @@ struct Options {
     int nRequestedEntries = 0;
     int timeLimitSeconds = 0;
 
+    std::string randomEngine{};
+    bool randomBenchmark = false;
+
     // reference to original argc and argv necessary to pass to G4UIExecutive
     int argc;
     char** argv;
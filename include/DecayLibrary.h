@@ -0,0 +1,51 @@
+
+#ifndef REST_DECAYLIBRARY_H
+#define REST_DECAYLIBRARY_H
+
+#include <G4ThreeVector.hh>
+#include <G4VUserPrimaryParticleInformation.hh>
+#include <map>
+#include <vector>
+
+class G4ParticleDefinition;
+class G4RadioactiveDecay;
+
+// Particle produced in the decay of a nucleus at rest. Internal Geant4 units are kept
+struct DecayProduct {
+    G4ParticleDefinition* fParticle = nullptr;
+    G4ThreeVector fDirection;
+    G4double fEnergy = 0;
+    G4double fTime = 0;  // relative to the decay, the decay time itself is sampled for each event
+};
+
+using DecayFinalState = std::vector<DecayProduct>;
+
+// Attached to the primaries that are the recoiling daughter nucleus of a sampled decay, so they are stacked
+// as if they had been produced by the decay of the source nucleus
+class DecayLibraryDaughterInformation : public G4VUserPrimaryParticleInformation {
+   public:
+    void Print() const override {}
+};
+
+// Pre-tabulated final states of the radioactive decay of nuclei at rest. Each thread holds its own library,
+// built on first use of each isotope from the 'G4RadioactiveDecay' process of the thread, so it follows the
+// ICM / ARM options of the physics list. Tabulation uses its own random engine, seeded from the run seed and
+// the isotope, so all threads build the same library and the random stream of the events is not consumed
+class DecayLibrary {
+   public:
+    DecayLibrary(size_t size, long seed);
+
+    // Returns nullptr if the particle cannot be sampled from the library (not a radioactive nucleus)
+    const DecayFinalState* Sample(G4ParticleDefinition* nucleus);
+
+   private:
+    const std::vector<DecayFinalState>& Tabulate(G4ParticleDefinition* nucleus);
+
+    size_t fSize;
+    long fSeed;
+    G4RadioactiveDecay* fRadioactiveDecay = nullptr;
+
+    std::map<const G4ParticleDefinition*, std::vector<DecayFinalState>> fFinalStates;
+};
+
+#endif  // REST_DECAYLIBRARY_H
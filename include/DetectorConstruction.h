@@ -9,6 +9,7 @@
 #include <G4PhysicalVolumeStore.hh>
 #include <G4VUserDetectorConstruction.hh>
 
+class G4Region;
 class SimulationManager;
 
 class DetectorConstruction : public G4VUserDetectorConstruction {
@@ -23,6 +24,9 @@ class DetectorConstruction : public G4VUserDetectorConstruction {
 
    public:
     G4VPhysicalVolume* GetPhysicalVolume(const G4String& physVolName) const;
+    // region with this name, or a new region rooted at the logical volume of a logical or physical volume
+    // with this name
+    static G4Region* FindOrCreateRegion(const G4String& name);
     inline G4VSolid* GetGeneratorSolid() const { return fGeneratorSolid; }
     inline G4ThreeVector GetGeneratorTranslation() const { return fGeneratorTranslation; }
 
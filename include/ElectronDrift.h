@@ -0,0 +1,78 @@
+
+#ifndef REST_ELECTRONDRIFT_H
+#define REST_ELECTRONDRIFT_H
+
+#include <TVector3.h>
+
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+class TRestGeant4GeometryInfo;
+class TRestGeant4Track;
+
+// Time binned readout signals of one (sub)event, stored instead of the hits when the drift stage is enabled
+struct ReadoutSignalEvent {
+    Int_t fEventID = 0;
+    Int_t fSubEventID = 0;
+    std::vector<Int_t> fChannelX;
+    std::vector<Int_t> fChannelY;
+    std::vector<Int_t> fTimeBin;
+    std::vector<Int_t> fCharge;  // number of electrons
+};
+
+// Parametrized drift of the ionization electrons of the hits in a gas volume towards a readout plane.
+// Units are mm, us, keV (energy of the hits) and eV (W-value). Diffusion coefficients are in sqrt(cm) and
+// attachment in 1/cm, as usually quoted for gas mixtures
+class ElectronDrift {
+   public:
+    struct Parameters {
+        std::string fVolume;
+        TVector3 fPlanePosition = {0, 0, 0};
+        TVector3 fPlaneNormal = {0, 0, 1};  // points from the readout plane into the drift volume
+        Double_t fDriftVelocity = 1;        // mm/us
+        Double_t fLongitudinalDiffusion = 0;
+        Double_t fTransverseDiffusion = 0;
+        Double_t fAttachment = 0;
+        Double_t fWValue = 26;
+        Double_t fPitch = 1;         // mm
+        Double_t fSamplingTime = 1;  // us
+    };
+
+    explicit ElectronDrift(const Parameters& parameters);
+
+    ReadoutSignalEvent Process(Int_t eventID, Int_t subEventID, const std::vector<TRestGeant4Track>& tracks,
+                               const TRestGeant4GeometryInfo& geometryInfo);
+
+    std::string ToString() const;
+
+   private:
+    Parameters fParameters;
+    TVector3 fPlaneU;
+    TVector3 fPlaneV;
+
+    Int_t fVolumeID = -1;  // resolved on first use, geometry is not available at construction
+
+    struct ChannelHash {
+        inline size_t operator()(const std::tuple<Int_t, Int_t, Int_t>& key) const {
+            // channels and time bins are small integers, 21 bits each keep them apart
+            return (size_t(uint32_t(std::get<0>(key))) & 0x1FFFFF) |
+                   ((size_t(uint32_t(std::get<1>(key))) & 0x1FFFFF) << 21) |
+                   ((size_t(uint32_t(std::get<2>(key))) & 0x1FFFFF) << 42);
+        }
+    };
+    std::unordered_map<std::tuple<Int_t, Int_t, Int_t>, Int_t, ChannelHash> fSignals;
+
+    // per hit bin probabilities of the diffusion, kept to reuse their capacity
+    std::vector<Double_t> fProbabilitiesU;
+    std::vector<Double_t> fProbabilitiesV;
+    std::vector<Double_t> fProbabilitiesTime;
+
+    // probabilities of a gaussian over bins of the given width, starting at 'firstBin'
+    static void BinProbabilities(Double_t mean, Double_t sigma, Double_t width, Int_t& firstBin,
+                                 std::vector<Double_t>& probabilities);
+};
+
+#endif  // REST_ELECTRONDRIFT_H
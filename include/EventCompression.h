@@ -0,0 +1,28 @@
+
+#ifndef REST_EVENTCOMPRESSION_H
+#define REST_EVENTCOMPRESSION_H
+
+#include <Rtypes.h>
+
+#include <memory>
+#include <vector>
+
+class TRestGeant4Event;
+
+// Streamed and compressed 'TRestGeant4Event', produced on the worker threads so the writer only has to copy
+// the buffer into the output file
+struct CompressedEvent {
+    Int_t fEventID = 0;
+    Int_t fSubEventID = 0;
+    Int_t fUncompressedSize = 0;  // buffer is stored uncompressed if its size is equal to this
+    std::vector<char> fBuffer;
+};
+
+namespace EventCompression {
+// 'compressionSettings' follows the ROOT convention (100 * algorithm + level), as in TFile
+CompressedEvent Compress(const TRestGeant4Event& event, int compressionSettings);
+
+std::unique_ptr<TRestGeant4Event> Decompress(const CompressedEvent& compressedEvent);
+}  // namespace EventCompression
+
+#endif  // REST_EVENTCOMPRESSION_H
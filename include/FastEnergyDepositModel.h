@@ -0,0 +1,35 @@
+#ifndef REST_FASTENERGYDEPOSITMODEL_H
+#define REST_FASTENERGYDEPOSITMODEL_H
+
+#include <G4EmCalculator.hh>
+#include <G4VFastSimulationModel.hh>
+
+// Ends electrons, positrons and gammas below an energy threshold inside passive regions, depositing their
+// kinetic energy where they are. Particles are only killed when they are unlikely to leave the region
+// envelope: electrons and positrons when their range is shorter than the distance to its boundary, gammas
+// when that distance is more than 'fGammaAttenuationLengths' attenuation lengths. Positrons are replaced by
+// their two annihilation photons at rest, which are tracked. The remaining bias on the escaping photon flux
+// comes from the bremsstrahlung of the killed electrons and positrons and from gammas scattered out of the
+// region from deeper than the attenuation length criterion, both small for low thresholds
+class FastEnergyDepositModel : public G4VFastSimulationModel {
+   public:
+    // a gamma threshold of 0 leaves gammas untouched
+    FastEnergyDepositModel(const G4String& name, G4Region* region, G4double energyThreshold,
+                           G4double gammaEnergyThreshold);
+
+    G4bool IsApplicable(const G4ParticleDefinition& particle) override;
+    G4bool ModelTrigger(const G4FastTrack& fastTrack) override;
+    void DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep) override;
+
+   private:
+    G4double fEnergyThreshold;       // electrons and positrons
+    G4double fGammaEnergyThreshold;  // gammas
+    // escape probability through the closest boundary is below exp(-10) for the unscattered gamma
+    static constexpr G4double fGammaAttenuationLengths = 10;
+
+    G4EmCalculator fEmCalculator;  // models are built per thread
+
+    G4double GetGammaAttenuationLength(const G4FastTrack& fastTrack);
+};
+
+#endif  // REST_FASTENERGYDEPOSITMODEL_H
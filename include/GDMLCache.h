@@ -0,0 +1,37 @@
+
+#ifndef REST_GDMLCACHE_H
+#define REST_GDMLCACHE_H
+
+#include <string>
+
+// Local cache of processed geometries, so that jobs sharing a geometry do not fetch its remote entities and
+// preprocess it again. Entries live in '<directory>/<key>/' and the key is the MD5 of the contents of the
+// GDML file, of its local file entities at any depth and of the values of the system variables (${}) that
+// they use. Remote entities are identified by their URL, so they are assumed not to change (use versioned
+// URLs). Geometries using unset system variables are not cached
+class GDMLCache {
+   public:
+    struct Entry {
+        std::string fGdmlFilename;  // processed single file GDML
+        std::string fGdmlVersion;
+        std::string fMaterialsVersion;
+    };
+
+    GDMLCache(const std::string& directory, bool offline);
+
+    // false if the geometry is not in the cache, fatal in offline mode
+    bool Lookup(const std::string& gdmlFilename, Entry& entry) const;
+    // adds the output of the GDML parser to the cache, an existing entry for the same key is kept
+    void Store(const std::string& gdmlFilename, const Entry& entry) const;
+
+    inline bool IsOffline() const { return fOffline; }
+
+   private:
+    std::string fDirectory;
+    bool fOffline = false;
+
+    // empty if the geometry cannot be identified
+    static std::string GetKey(const std::string& gdmlFilename);
+};
+
+#endif  // REST_GDMLCACHE_H
@@ -0,0 +1,37 @@
+
+#ifndef REST_GEOMETRYINDEX_H
+#define REST_GEOMETRYINDEX_H
+
+#include <Rtypes.h>
+
+#include <G4AffineTransform.hh>
+#include <vector>
+
+class G4VPhysicalVolume;
+
+// Flattened table of all the volumes of the geometry tree, at any depth. A volume placed several times
+// (same physical volume under different mothers or copies of an assembly) gets one entry per placement.
+// Built once after construction, read only afterwards and shared by all threads
+class GeometryIndex {
+   public:
+    struct Volume {
+        const G4VPhysicalVolume* fPhysicalVolume = nullptr;
+        Int_t fCopyNumber = 0;  // -1 for replicated and parameterised volumes, all copies share the entry
+        Int_t fParent = -1;     // -1 for the world
+        Int_t fDepth = 0;
+        G4AffineTransform fGlobalTransform;  // local to world frame, identity for the world
+    };
+
+    explicit GeometryIndex(const G4VPhysicalVolume* world);
+
+    inline size_t GetNumberOfVolumes() const { return fVolumes.size(); }
+    inline const Volume& GetVolume(Int_t id) const { return fVolumes[id]; }
+    inline const std::vector<Volume>& GetVolumes() const { return fVolumes; }
+
+   private:
+    std::vector<Volume> fVolumes;  // depth first order, world is 0
+
+    void Add(const G4VPhysicalVolume* physicalVolume, Int_t parent);
+};
+
+#endif  // REST_GEOMETRYINDEX_H
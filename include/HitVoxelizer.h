@@ -0,0 +1,45 @@
+
+#ifndef REST_HITVOXELIZER_H
+#define REST_HITVOXELIZER_H
+
+#include <TRotation.h>
+#include <TVector3.h>
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Sparse list of voxels of one (sub)event, this is what gets written to the output file instead of the hits
+struct VoxelEvent {
+    Int_t fEventID = 0;
+    Int_t fSubEventID = 0;
+    std::vector<Int_t> fX;
+    std::vector<Int_t> fY;
+    std::vector<Int_t> fZ;
+    std::vector<Float_t> fEnergy;
+};
+
+// Bins the energy deposited in the active volumes onto a readout grid. Units are mm, keV and degrees
+class HitVoxelizer {
+   public:
+    HitVoxelizer(const TVector3& voxelSize, const TVector3& origin, const TVector3& rotation);
+
+    void Fill(const TVector3& position, Double_t energy);
+    void Clear() { fVoxels.clear(); }
+    inline bool IsEmpty() const { return fVoxels.empty(); }
+
+    VoxelEvent GetVoxelEvent(Int_t eventID, Int_t subEventID) const;
+
+    std::string ToString() const;
+
+   private:
+    TVector3 fVoxelSize;
+    TVector3 fOrigin;
+    TVector3 fRotation;
+    TRotation fInverseRotation;
+
+    std::map<std::tuple<Int_t, Int_t, Int_t>, Double_t> fVoxels;
+};
+
+#endif  // REST_HITVOXELIZER_H
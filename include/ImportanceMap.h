@@ -0,0 +1,68 @@
+
+#ifndef REST_IMPORTANCEMAP_H
+#define REST_IMPORTANCEMAP_H
+
+#include <TVector3.h>
+
+#include <G4ThreeVector.hh>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class G4VPhysicalVolume;
+
+// Importance of the cells of a regular mesh, estimated in a pilot run. Population is the number of tracks
+// that visit a cell and contribution the number of those tracks that deposit energy in a sensitive volume
+// or have a descendant that does. The importance of a cell is contribution / population normalized to the
+// most important cell, so the ratio between two cells is the splitting (or roulette) factor for particles
+// moving between them. Maps written by a pilot run can be read back with 'Read'. Units are mm
+class ImportanceMap {
+   public:
+    ImportanceMap(const TVector3& bins, const TVector3& minimum, const TVector3& maximum);
+
+    // mesh covers the bounding box of the world when neither bound is given
+    inline bool HasBounds() const { return fMinimum != TVector3() || fMaximum != TVector3(); }
+    void SetBoundsFromWorld(const G4VPhysicalVolume* world);
+
+    // -1 outside the mesh
+    Int_t GetCell(const G4ThreeVector& position) const;
+    // appends the cells crossed by a step, in order, skipping the last cell already in 'cells'
+    void AddCrossedCells(const G4ThreeVector& start, const G4ThreeVector& end,
+                         std::vector<Int_t>& cells) const;
+
+    // Called once per event, can be called concurrently from several threads
+    void AddEvent(const std::unordered_map<Int_t, Double_t>& population,
+                  const std::unordered_map<Int_t, Double_t>& contribution);
+
+    // Population, contribution and importance histograms
+    void Write(const std::string& filename);
+    // Mesh, population and contribution of a map written by 'Write'
+    static std::unique_ptr<ImportanceMap> Read(const std::string& filename);
+
+    // Importance of each cell, as G4IStore expects them: normalized to the most important cell and
+    // strictly positive, cells without contribution get the lowest importance found so particles entering
+    // them are rouletted instead of killed. Empty if no cell has a contribution
+    std::vector<Double_t> GetImportances() const;
+    // Importance of the cell containing 'position' in a map obtained from 'Read', -1 outside the mesh
+    Double_t GetImportance(const G4ThreeVector& position) const;
+
+    std::string ToString() const;
+
+   private:
+    // largest contribution / population ratio, callers hold the lock
+    Double_t GetMaximumRatio() const;
+
+    Int_t fBins[3];
+    TVector3 fMinimum;
+    TVector3 fMaximum;
+
+    mutable std::mutex fMutex;
+    size_t fNumberOfEvents = 0;
+    std::vector<Double_t> fPopulation;
+    std::vector<Double_t> fContribution;
+    std::vector<Double_t> fImportances;  // only for maps read from a file
+};
+
+#endif  // REST_IMPORTANCEMAP_H
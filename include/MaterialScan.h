@@ -0,0 +1,59 @@
+
+#ifndef REST_MATERIALSCAN_H
+#define REST_MATERIALSCAN_H
+
+#include <TH2D.h>
+#include <TVector2.h>
+#include <TVector3.h>
+
+#include <G4ThreeVector.hh>
+#include <map>
+#include <mutex>
+#include <string>
+
+// Material budget map obtained by casting one geantino per bin of a 2D grid. In 'point' mode rays start at
+// the origin and the grid is in (theta, phi) in degrees around the scan direction. In 'plane' mode rays
+// start on the plane through the origin normal to the scan direction and the grid is in (u, v) in mm.
+// Path length (mm) is stored per volume and areal density (g/cm2) per material and in total
+class MaterialScan {
+   public:
+    enum class Mode { Point, Plane };
+
+    struct Parameters {
+        Mode fMode = Mode::Point;
+        TVector3 fOrigin = {0, 0, 0};     // mm
+        TVector3 fDirection = {0, 0, 1};  // polar axis in 'point' mode, ray direction in 'plane' mode
+        Int_t fBinsX = 90;
+        Int_t fBinsY = 180;
+        TVector2 fRangeX = {0, 180};
+        TVector2 fRangeY = {0, 360};
+    };
+
+    explicit MaterialScan(const Parameters& parameters);
+
+    inline size_t GetNumberOfRays() const { return size_t(fParameters.fBinsX) * fParameters.fBinsY; }
+    void GetRay(size_t ray, G4ThreeVector& position, G4ThreeVector& direction) const;
+
+    // Called once per ray, can be called concurrently from several threads
+    void AddRay(size_t ray, const std::map<std::string, Double_t>& volumePathLengths,
+                const std::map<std::string, Double_t>& materialArealDensities);
+
+    // Writes the maps into a 'MaterialScan' directory of the current file
+    void Write();
+
+    std::string ToString() const;
+
+   private:
+    TH2D& GetMap(std::map<std::string, TH2D>& maps, const std::string& name, const std::string& title);
+
+    Parameters fParameters;
+    G4ThreeVector fAxis;
+    G4ThreeVector fAxisU;
+    G4ThreeVector fAxisV;
+
+    std::mutex fMutex;
+    std::map<std::string, TH2D> fVolumeMaps;
+    std::map<std::string, TH2D> fMaterialMaps;
+};
+
+#endif  // REST_MATERIALSCAN_H
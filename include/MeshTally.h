@@ -0,0 +1,68 @@
+
+#ifndef REST_MESHTALLY_H
+#define REST_MESHTALLY_H
+
+#include <TVector3.h>
+
+#include <G4ThreeVector.hh>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Scoring mesh over a box: deposited energy (keV) and optionally track length (mm) of some particles per
+// voxel. Steps are split between the voxels they cross. The energy lost by charged particles is shared in
+// proportion to the length in each voxel, neutral particles deposit it at the post-step point. Each thread
+// fills its own grid, grids are merged at the end of the run. Flux (mm-2) is the track length divided by the
+// voxel volume
+class MeshTally {
+   public:
+    struct Parameters {
+        std::string fName;
+        TVector3 fMinimum;
+        TVector3 fMaximum;
+        Int_t fBins[3] = {1, 1, 1};
+        std::vector<std::string> fTrackLengthParticles;  // "all" for all particles together
+    };
+
+    class Grid {
+       public:
+        explicit Grid(const MeshTally& tally);
+
+        // continuous energy is shared along the step, local energy goes to the voxel of the end point
+        void Fill(const G4ThreeVector& start, const G4ThreeVector& end, Double_t continuousEnergy,
+                  Double_t localEnergy, const std::string& particleName);
+
+       private:
+        const MeshTally& fTally;
+        std::vector<Double_t> fEnergy;
+        std::vector<std::vector<Double_t> > fTrackLength;  // one grid per track length particle
+
+        friend class MeshTally;
+    };
+
+    explicit MeshTally(const Parameters& parameters);
+
+    inline const std::string& GetName() const { return fParameters.fName; }
+
+    // Can be called concurrently from several threads
+    void Merge(const Grid& grid);
+
+    // Writes the histograms into a 'MeshTallies' directory of the current file
+    void Write();
+
+    std::string ToString() const;
+
+   private:
+    inline size_t GetNumberOfVoxels() const {
+        return size_t(fParameters.fBins[0]) * fParameters.fBins[1] * fParameters.fBins[2];
+    }
+
+    Parameters fParameters;
+    Double_t fVoxelSize[3];
+
+    std::mutex fMutex;
+    std::vector<Double_t> fEnergy;
+    std::vector<std::vector<Double_t> > fTrackLength;
+};
+
+#endif  // REST_MESHTALLY_H
@@ -0,0 +1,68 @@
+
+#ifndef REST_PHASESPACE_H
+#define REST_PHASESPACE_H
+
+#include <Rtypes.h>
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Particle crossing the phase space boundary. Units are mm, keV and us
+#pragma pack(push, 1)
+struct PhaseSpaceRecord {
+    Int_t fPDGCode;
+    Float_t fPosition[3];
+    Float_t fDirection[3];
+    Float_t fEnergy;
+    Double_t fTime;
+    Float_t fWeight;
+};
+#pragma pack(pop)
+
+// Binary file layout: 8 byte magic "RG4PHSP1", record size (uint32), number of primaries of the run that
+// produced the file (uint64) and number of records (uint64), followed by the records
+class PhaseSpaceWriter {
+   public:
+    explicit PhaseSpaceWriter(const std::string& filename);
+    ~PhaseSpaceWriter();
+
+    void Write(const std::vector<PhaseSpaceRecord>& records);
+    void Close(uint64_t numberOfPrimaries);
+
+    inline const std::string& GetFilename() const { return fFilename; }
+
+   private:
+    std::string fFilename;
+    std::ofstream fFile;
+    std::mutex fMutex;
+    uint64_t fNumberOfRecords = 0;
+};
+
+// Records are served in order, each one 'recycling' times, going back to the start of the file when all
+// records have been used
+class PhaseSpaceReader {
+   public:
+    PhaseSpaceReader(const std::string& filename, int recycling);
+
+    PhaseSpaceRecord Next();
+
+    inline uint64_t GetNumberOfRecords() const { return fNumberOfRecords; }
+    inline uint64_t GetNumberOfPrimaries() const { return fNumberOfPrimaries; }
+
+   private:
+    std::string fFilename;
+    std::ifstream fFile;
+    std::mutex fMutex;
+
+    int fRecycling = 1;
+    int fUses = 0;
+    uint64_t fNumberOfRecords = 0;
+    uint64_t fNumberOfPrimaries = 0;
+    uint64_t fNextRecord = 0;
+    PhaseSpaceRecord fCurrentRecord{};
+};
+
+#endif  // REST_PHASESPACE_H
@@ -14,9 +14,14 @@ class PhysicsList : public G4VModularPhysicsList {
     explicit PhysicsList(TRestGeant4PhysicsLists* restPhysicsLists);
     ~PhysicsList() override;
 
+    // fast simulation models can be attached to regions, see FastEnergyDepositModel
+    inline void EnableFastSimulation() { fFastSimulation = true; }
+
    protected:
     // Construct particle and physics
     virtual void InitializePhysicsLists();
+    G4VPhysicsConstructor* CreateEmPhysicsList(const std::string& name);
+    void ConfigureEmRegionPhysics() const;
 
     void ConstructParticle() override;
     void ConstructProcess() override;
@@ -27,12 +32,16 @@ class PhysicsList : public G4VModularPhysicsList {
 
     G4VPhysicsConstructor* fEmPhysicsList = nullptr;
     std::string fEmPhysicsListName;  // Can be different from the output of GetPhysicsName
+    // (region, EM constructor) pairs, applied by the global EM constructor on top of its own models
+    std::vector<std::pair<std::string, std::string> > fEmRegionPhysics;
 
     G4VPhysicsConstructor* fDecPhysicsList = nullptr;
     G4VPhysicsConstructor* fRadDecPhysicsList = nullptr;
     std::vector<G4VPhysicsConstructor*> fHadronPhys;
 
     TRestGeant4PhysicsLists* fRestPhysicsLists = nullptr;
+
+    bool fFastSimulation = false;
 };
 
 #endif
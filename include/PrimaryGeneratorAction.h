@@ -13,8 +13,10 @@
 #include <fstream>
 #include <globals.hh>
 #include <iostream>
+#include <memory>
 #include <mutex>
 
+#include "DecayLibrary.h"
 #include "DetectorConstruction.h"
 
 class G4Event;
@@ -60,6 +62,11 @@ class PrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction {
 
     TRandom* fRandom = nullptr;
 
+    std::unique_ptr<DecayLibrary> fDecayLibrary;
+
+    void GeneratePrimaryFromPhaseSpace(G4Event* event);
+    bool GeneratePrimariesFromDecayLibrary(G4Event* event);
+
     void SetParticlePosition();
     G4ParticleDefinition* SetParticleDefinition(Int_t particleSourceIndex,
                                                 const TRestGeant4Particle& particle);
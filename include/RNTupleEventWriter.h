@@ -0,0 +1,98 @@
+
+#ifndef REST_RNTUPLEEVENTWRITER_H
+#define REST_RNTUPLEEVENTWRITER_H
+
+#ifdef RESTG4_WITH_RNTUPLE
+
+#include <ROOT/RNTupleFillContext.hxx>
+#include <ROOT/RNTupleParallelWriter.hxx>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class TRestGeant4Event;
+
+// The RNTuple classes moved from 'ROOT::Experimental' to 'ROOT' in ROOT 6.34 and 6.36, a class at a time.
+// Names are looked up in both, so the writer builds with any version since 6.32
+namespace ROOT::Experimental {}
+namespace RNTupleAPI {
+using namespace ROOT;
+using namespace ROOT::Experimental;
+}  // namespace RNTupleAPI
+
+// Writes the events into an RNTuple named 'Events'. Tracks are stored as collections and hits as collections
+// of collections, so no dictionaries are needed. Units are the same as in 'TRestGeant4Event'. The energy per
+// volume, particle and process is stored flattened, one entry per combination
+class RNTupleEventWriter {
+   public:
+    // 'hitFields' are the optional hit columns stored in the events, see 'HitFields'
+    RNTupleEventWriter(const std::string& filename, int compressionSettings, unsigned int hitFields);
+    ~RNTupleEventWriter();  // data set is committed once all fill contexts are gone
+
+    // flattened energy per volume, particle and process of an event
+    struct VolumeEnergies {
+        std::vector<std::string> fVolume;
+        std::vector<std::string> fParticle;
+        std::vector<std::string> fProcess;
+        std::vector<double> fEnergy;
+    };
+
+    // One per thread, each one fills its own clusters
+    class FillContext {
+       public:
+        FillContext(std::shared_ptr<RNTupleAPI::RNTupleFillContext> context, unsigned int hitFields);
+        ~FillContext();
+
+        void Fill(const TRestGeant4Event& event, const VolumeEnergies& volumeEnergies);
+
+       private:
+        std::shared_ptr<RNTupleAPI::RNTupleFillContext> fContext;
+        std::unique_ptr<RNTupleAPI::REntry> fEntry;
+        unsigned int fHitFields;  // optional hit columns that are stored in the events
+
+        std::shared_ptr<int> fEventID;
+        std::shared_ptr<int> fSubEventID;
+        std::shared_ptr<double> fSensitiveVolumeEnergy;
+        std::shared_ptr<std::vector<float>> fPrimaryPosition;
+        std::shared_ptr<std::vector<std::string>> fPrimaryParticleNames;
+        std::shared_ptr<std::vector<float>> fPrimaryEnergies;
+
+        std::shared_ptr<std::vector<std::string>> fEnergyInVolumeName;
+        std::shared_ptr<std::vector<std::string>> fEnergyInVolumeParticle;
+        std::shared_ptr<std::vector<std::string>> fEnergyInVolumeProcess;
+        std::shared_ptr<std::vector<double>> fEnergyInVolume;
+
+        std::shared_ptr<std::vector<int>> fTrackID;
+        std::shared_ptr<std::vector<int>> fTrackParentID;
+        std::shared_ptr<std::vector<std::string>> fTrackParticleName;
+        std::shared_ptr<std::vector<std::string>> fTrackCreatorProcess;
+        std::shared_ptr<std::vector<float>> fTrackInitialKineticEnergy;
+        std::shared_ptr<std::vector<double>> fTrackGlobalTime;
+
+        std::shared_ptr<std::vector<std::vector<float>>> fHitsX;
+        std::shared_ptr<std::vector<std::vector<float>>> fHitsY;
+        std::shared_ptr<std::vector<std::vector<float>>> fHitsZ;
+        std::shared_ptr<std::vector<std::vector<float>>> fHitsEnergy;
+        std::shared_ptr<std::vector<std::vector<double>>> fHitsTime;
+        std::shared_ptr<std::vector<std::vector<float>>> fHitsKineticEnergy;
+        std::shared_ptr<std::vector<std::vector<float>>> fHitsDirectionX;
+        std::shared_ptr<std::vector<std::vector<float>>> fHitsDirectionY;
+        std::shared_ptr<std::vector<std::vector<float>>> fHitsDirectionZ;
+        std::shared_ptr<std::vector<std::vector<int>>> fHitsVolumeID;
+        std::shared_ptr<std::vector<std::vector<int>>> fHitsProcessID;
+    };
+
+    std::unique_ptr<FillContext> CreateFillContext();
+
+    inline const std::string& GetFilename() const { return fFilename; }
+
+   private:
+    std::string fFilename;
+    unsigned int fHitFields;
+    std::unique_ptr<RNTupleAPI::RNTupleParallelWriter> fWriter;
+};
+
+#endif  // RESTG4_WITH_RNTUPLE
+
+#endif  // REST_RNTUPLEEVENTWRITER_H
@@ -0,0 +1,80 @@
+
+#ifndef REST_RANDOMENGINE_H
+#define REST_RANDOMENGINE_H
+
+#include <TRandom.h>
+
+#include <CLHEP/Random/RandomEngine.h>
+#include <G4UserWorkerThreadInitialization.hh>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Random number engines selectable with the 'randomEngine' RML parameter or the '--rng' CLI option. The same
+// engine is used by Geant4 and, through Geant4TRandom, by the ROOT side sampling
+namespace RandomEngine {
+std::string GetAvailableNames();
+CLHEP::HepRandomEngine* Create(const std::string& name);
+
+// Random numbers per second of a new engine of this type, measured drawing 'count' numbers
+double Benchmark(const std::string& name, size_t count);
+}  // namespace RandomEngine
+
+// Engine forwarding to another one and counting the random numbers drawn, only used when the random
+// benchmark is enabled since it adds an indirection to every call
+class CountingRandomEngine : public CLHEP::HepRandomEngine {
+   public:
+    explicit CountingRandomEngine(CLHEP::HepRandomEngine* engine);
+    ~CountingRandomEngine() override;
+
+    double flat() override {
+        fCount++;
+        return fEngine->flat();
+    }
+    void flatArray(const int size, double* vect) override {
+        fCount += size;
+        fEngine->flatArray(size, vect);
+    }
+    void setSeed(long seed, int n) override { fEngine->setSeed(seed, n); }
+    void setSeeds(const long* seeds, int n) override { fEngine->setSeeds(seeds, n); }
+    void saveStatus(const char* filename) const override { fEngine->saveStatus(filename); }
+    void restoreStatus(const char* filename) override { fEngine->restoreStatus(filename); }
+    void showStatus() const override { fEngine->showStatus(); }
+    std::string name() const override { return fEngine->name(); }
+    std::ostream& put(std::ostream& os) const override { return fEngine->put(os); }
+    std::istream& get(std::istream& is) override { return fEngine->get(is); }
+    std::vector<unsigned long> put() const override { return fEngine->put(); }
+    bool get(const std::vector<unsigned long>& state) override { return fEngine->get(state); }
+    bool getState(const std::vector<unsigned long>& state) override { return fEngine->getState(state); }
+
+    // numbers drawn by all the counting engines, only meaningful when no thread is simulating
+    static uint64_t GetTotalCount();
+
+   private:
+    std::unique_ptr<CLHEP::HepRandomEngine> fEngine;
+    uint64_t fCount = 0;  // not atomic, each engine is used by a single thread
+};
+
+// Workers get a new engine of the selected type, Geant4 only knows how to clone its own engine types
+class WorkerThreadInitialization : public G4UserWorkerThreadInitialization {
+   public:
+    WorkerThreadInitialization(const std::string& engineName, bool countRandomNumbers);
+
+    void SetupRNGEngine(const CLHEP::HepRandomEngine* masterEngine) const override;
+
+   private:
+    std::string fEngineName;
+    bool fCountRandomNumbers;
+};
+
+// ROOT sampling methods taking a TRandom (TF1::GetRandom, ...) draw from the Geant4 engine of the thread, so
+// they follow the engine selection and the per event seeding of Geant4
+class Geant4TRandom : public TRandom {
+   public:
+    Double_t Rndm() override;
+    void RndmArray(Int_t n, Float_t* array) override;
+    void RndmArray(Int_t n, Double_t* array) override;
+    void SetSeed(ULong_t) override {}
+};
+
+#endif  // REST_RANDOMENGINE_H
@@ -10,8 +10,46 @@
 
 #include <queue>
 #include <thread>
+#include <unordered_map>
+
+#include "ActivationTally.h"
+#include "ElectronDrift.h"
+#include "EventCompression.h"
+#include "GeometryIndex.h"
+#include "HitVoxelizer.h"
+#include "ImportanceMap.h"
+#include "MaterialScan.h"
+#include "MeshTally.h"
+#include "PhaseSpace.h"
+#include "RNTupleEventWriter.h"
+#include "StepBuffer.h"
+#include "SurfaceTally.h"
+#include "ThreadContext.h"
 
 class OutputManager;
+class G4Material;
+class G4ParticleDefinition;
+class G4VPhysicalVolume;
+class G4VProcess;
+
+namespace HitFields {
+// Optional per-hit columns of 'TRestGeant4Hits'. Position, energy, process ID and volume ID are always stored
+enum Field : unsigned int {
+    Time = 1 << 0,
+    KineticEnergy = 1 << 1,
+    MomentumDirection = 1 << 2,
+};
+constexpr unsigned int All = Time | KineticEnergy | MomentumDirection;
+
+// 'TNamed' in the output file whose title lists the stored fields. The columns not listed there hold one
+// placeholder per hit: 'UnsetKineticEnergy' and a (0,0,0) momentum direction. Time is part of 'TRestHits' and
+// cannot be dropped, without 'Time' it is zero for every hit
+constexpr const char* ObjectName = "Geant4HitFields";
+constexpr Float_t UnsetKineticEnergy = -1;  // keV
+
+unsigned int FromString(const std::string& fields);  // comma separated list such as "energy,time"
+std::string ToString(unsigned int fields);
+}  // namespace HitFields
 
 class SimulationManager {
    public:
@@ -78,6 +116,186 @@ class SimulationManager {
     std::vector<OutputManager*> fOutputManagerContainer = {};
     long fTimeStartUnix = 0;
 
+    /* Hit storage */
+   public:
+    void InitializeHitStorageOptions();
+    inline unsigned int GetHitFields() const { return fHitFields; }
+    inline bool GetRemoveZeroEnergyHits() const { return fRemoveZeroEnergyHits; }
+
+   private:
+    unsigned int fHitFields = HitFields::All;
+    bool fRemoveZeroEnergyHits = false;
+
+    /* Event compression on workers */
+   public:
+    void InitializeEventCompression();
+    inline bool GetCompressEventsInWorkers() const { return fCompressedEventTree != nullptr; }
+    inline int GetCompressionSettings() const { return fCompressionSettings; }
+    // Keeps the same order in 'EventTree' and 'CompressedEventTree'
+    void InsertCompressedEvent(std::unique_ptr<TRestGeant4Event>& event, CompressedEvent& compressedEvent);
+
+   private:
+    int fCompressionSettings = 0;
+    std::queue<CompressedEvent> fCompressedEventContainer;
+    TTree* fCompressedEventTree = nullptr;
+    CompressedEvent fCompressedEvent;  // Branches on CompressedEventTree
+
+    /* RNTuple output */
+   public:
+    void InitializeRNTupleOutput();
+#ifdef RESTG4_WITH_RNTUPLE
+    inline RNTupleEventWriter* GetRNTupleWriter() const { return fRNTupleWriter.get(); }
+
+   private:
+    void CloseRNTupleOutput();
+
+    std::unique_ptr<RNTupleEventWriter> fRNTupleWriter;
+#endif
+
+    /* Voxelization */
+   public:
+    void InitializeVoxelization();
+    inline const HitVoxelizer* GetVoxelizer() const { return fVoxelizer.get(); }
+    void InsertVoxelEvent(VoxelEvent& voxelEvent);
+
+    void WriteAuxiliaryOutput();
+
+   private:
+    std::unique_ptr<HitVoxelizer> fVoxelizer;  // only holds the grid definition, filled on each OutputManager
+    std::queue<VoxelEvent> fVoxelEventContainer;
+    TTree* fVoxelTree = nullptr;
+    VoxelEvent fVoxelEvent;  // Branches on VoxelTree
+
+    /* Electron drift */
+   public:
+    void InitializeElectronDrift();
+    inline const ElectronDrift* GetElectronDrift() const { return fElectronDrift.get(); }
+    void InsertReadoutSignalEvent(ReadoutSignalEvent& signalEvent);
+
+   private:
+    std::unique_ptr<ElectronDrift> fElectronDrift;  // only holds the parameters, copied on each OutputManager
+    std::queue<ReadoutSignalEvent> fReadoutSignalEventContainer;
+    TTree* fReadoutSignalTree = nullptr;
+    ReadoutSignalEvent fReadoutSignalEvent;  // Branches on ReadoutSignalTree
+
+    /* Phase space */
+   public:
+    void InitializePhaseSpace();
+    inline PhaseSpaceWriter* GetPhaseSpaceWriter() const { return fPhaseSpaceWriter.get(); }
+    inline PhaseSpaceReader* GetPhaseSpaceReader() const { return fPhaseSpaceReader.get(); }
+    inline const std::string& GetPhaseSpaceVolume() const { return fPhaseSpaceVolume; }
+    inline bool GetPhaseSpaceKill() const { return fPhaseSpaceKill; }
+    inline bool GetPhaseSpaceRandomRotation() const { return fPhaseSpaceRandomRotation; }
+    inline const TVector3& GetPhaseSpaceRotationAxis() const { return fPhaseSpaceRotationAxis; }
+
+   private:
+    std::unique_ptr<PhaseSpaceWriter> fPhaseSpaceWriter;
+    std::unique_ptr<PhaseSpaceReader> fPhaseSpaceReader;
+    std::string fPhaseSpaceVolume;
+    bool fPhaseSpaceKill = true;
+    bool fPhaseSpaceRandomRotation = false;
+    TVector3 fPhaseSpaceRotationAxis = {0, 0, 1};
+
+    /* Geometry index */
+   public:
+    // built on detector construction, before the REST geometry info is populated from it
+    inline void SetGeometryIndex(std::unique_ptr<const GeometryIndex> index) {
+        fGeometryIndex = std::move(index);
+    }
+    inline const GeometryIndex* GetGeometryIndex() const { return fGeometryIndex.get(); }
+
+   private:
+    std::unique_ptr<const GeometryIndex> fGeometryIndex;
+
+    /* Event overlay */
+   public:
+    void InitializeEventOverlay();
+    inline const std::vector<TRestGeant4Event>& GetOverlayLibrary() const { return fOverlayLibrary; }
+    inline double GetOverlayMeanNumberOfEvents() const { return fOverlayMeanNumberOfEvents; }
+    inline double GetOverlayTimeWindow() const { return fOverlayTimeWindow; }
+    inline const TVector3& GetOverlayTranslation() const { return fOverlayTranslation; }
+
+   private:
+    std::vector<TRestGeant4Event> fOverlayLibrary;  // read only once filled, shared by all threads
+    double fOverlayMeanNumberOfEvents = 0;
+    double fOverlayTimeWindow = 0;               // us
+    TVector3 fOverlayTranslation = {0, 0, 0};  // size of the box of random translations, in mm
+
+    /* Decay library */
+   public:
+    void InitializeDecayLibrary();
+    inline size_t GetDecayLibrarySize() const { return fDecayLibrarySize; }
+
+   private:
+    size_t fDecayLibrarySize = 0;  // decays tabulated per isotope and thread, 0 disables the library
+
+    /* Material scan */
+   public:
+    void InitializeMaterialScan();
+    inline MaterialScan* GetMaterialScan() const { return fMaterialScan.get(); }
+
+   private:
+    std::unique_ptr<MaterialScan> fMaterialScan;  // when set, no events are built or stored
+
+    /* Fast simulation */
+   public:
+    void InitializeFastSimulation();
+    inline const std::vector<std::string>& GetFastSimulationRegions() const { return fFastSimulationRegions; }
+    inline double GetFastSimulationEnergyThreshold() const { return fFastSimulationEnergyThreshold; }
+    inline double GetFastSimulationGammaEnergyThreshold() const {
+        return fFastSimulationGammaEnergyThreshold;
+    }
+
+   private:
+    std::vector<std::string> fFastSimulationRegions;  // region or volume names
+    double fFastSimulationEnergyThreshold = 0;        // keV
+    double fFastSimulationGammaEnergyThreshold = 0;   // keV, 0 leaves gammas untouched
+
+    /* Pilot run */
+   public:
+    void InitializePilot(const std::string& importanceMapFilename);
+    inline ImportanceMap* GetImportanceMap() const { return fImportanceMap.get(); }
+
+   private:
+    std::unique_ptr<ImportanceMap> fImportanceMap;  // only in pilot runs
+    std::string fImportanceMapFilename;
+
+    /* Mesh tallies */
+   public:
+    void InitializeMeshTallies();
+    inline const std::vector<std::unique_ptr<MeshTally> >& GetMeshTallies() const { return fMeshTallies; }
+
+   private:
+    std::vector<std::unique_ptr<MeshTally> > fMeshTallies;
+
+    /* Surface tallies */
+   public:
+    void InitializeSurfaceTallies();
+    inline const std::vector<std::unique_ptr<SurfaceTally> >& GetSurfaceTallies() const {
+        return fSurfaceTallies;
+    }
+
+   private:
+    std::vector<std::unique_ptr<SurfaceTally> > fSurfaceTallies;
+
+    /* Activation tally */
+   public:
+    void InitializeActivationTally();
+    inline ActivationTally* GetActivationTally() const { return fActivationTally.get(); }
+
+   private:
+    std::unique_ptr<ActivationTally> fActivationTally;
+
+    /* Event building */
+   public:
+    void InitializeEventBuilding();
+    inline double GetEventBuildingWindow() const { return fEventBuildingWindow; }
+    inline double GetEventBuildingDeadTime() const { return fEventBuildingDeadTime; }
+
+   private:
+    double fEventBuildingWindow = 0;    // us, 0 stores each sub-event on its own
+    double fEventBuildingDeadTime = 0;  // us, non paralyzable, counted from the start of each built event
+
     /* Primary generation */
    public:
     void InitializeUserDistributions();
@@ -94,6 +312,8 @@ class OutputManager {
     OutputManager(const SimulationManager*);
     void UpdateEvent();
     void FinishAndSubmitEvent();
+    // groups the sub-events of the Geant4 event in time windows, called at the end of the Geant4 event
+    void SubmitTimeWindowEvents();
 
     bool IsEmptyEvent() const;
 
@@ -105,25 +325,136 @@ class OutputManager {
     void UpdateTrack(const G4Track*);
 
     void RecordStep(const G4Step*);
+    void BufferStep(const G4Step*);
+    inline const StepBuffer& GetStepBuffer() const { return fStepBuffer; }
+    void RecordPhaseSpace(const G4Step*);
+    void RecordMaterialScanStep(const G4Step*);
+    void RecordPilotStep(const G4Step*);
+    void FillMeshTallies(const G4Step*);
+    void RecordBoundaryCrossing(const G4Step*);
+    void RecordIsotopeProduction(const G4Track*);
+    void FinishTrackLineage(const G4Track*, size_t numberOfSecondaries);
+    void ResolveKilledSecondary(Int_t parentID);
+    void MergeTallies();
+
+    // IDs of 'fGeant4PhysicsInfo', the shared tables are only updated the first time each thread sees a name
+    Int_t GetParticleID(const G4ParticleDefinition*);
+    Int_t GetProcessID(const G4VProcess*);
 
     void AddSensitiveEnergy(Double_t energy, const char* physicalVolumeName);
     void AddEnergyToVolumeForParticleForProcess(Double_t energy, const char* volumeName,
                                                 const char* particleName, const char* processName);
 
     inline int GetEventCounter() const { return fProcessedEventsCounter; }
+    inline size_t GetNumberOfTriggers() const { return fNumberOfTriggers; }
+    inline size_t GetNumberOfDeadTimeLosses() const { return fNumberOfDeadTimeLosses; }
     inline void ResetEventCounter() { fProcessedEventsCounter = 0; }
 
     void BeginOfEventAction();
 
     int GetCurrentEventID() const { return fEvent->GetID(); }
 
+    inline SimulationManager* GetSimulationManager() const { return fSimulationManager; }
+    inline HitVoxelizer* GetVoxelizer() const { return fVoxelizer.get(); }
+    // only valid once the thread has started processing events
+    inline const ThreadContext& GetContext() const { return *fContext; }
+
    private:
     std::unique_ptr<TRestGeant4Event> fEvent{};
     SimulationManager* fSimulationManager = nullptr;
 
     int fProcessedEventsCounter = 0;
 
+    std::unique_ptr<HitVoxelizer> fVoxelizer{};
+    std::unique_ptr<ElectronDrift> fElectronDrift{};
+
+    std::unique_ptr<const ThreadContext> fContext{};
+
+    StepBuffer fStepBuffer;
+
+    // running mean and variance of the number of tracks of the events of this thread, used to reserve the
+    // track vector of each new event
+    size_t fTracksPerEventSamples = 0;
+    Double_t fTracksPerEventMean = 0;
+    Double_t fTracksPerEventM2 = 0;
+
+    std::vector<PhaseSpaceRecord> fPhaseSpaceRecords;
+    std::unordered_set<Int_t> fPhaseSpaceTrackIDs;  // tracks of the current event already recorded
+
+    std::unordered_map<const G4ParticleDefinition*, Int_t> fParticleIDs;
+    std::unordered_map<const G4VProcess*, Int_t> fProcessIDs;
+
+    // energy of the current event per volume, particle and process (nullptr for the initial step). Steps only
+    // add to it, the names are looked up once per key when the event is finished
+    using VolumeEnergyKey =
+        std::tuple<const ThreadContext::Volume*, const G4ParticleDefinition*, const G4VProcess*>;
+    struct VolumeEnergyKeyHash {
+        inline size_t operator()(const VolumeEnergyKey& key) const {
+            size_t hash = std::hash<const void*>()(std::get<0>(key));
+            hash ^= std::hash<const void*>()(std::get<1>(key)) + 0x9E3779B9 + (hash << 6) + (hash >> 2);
+            hash ^= std::hash<const void*>()(std::get<2>(key)) + 0x9E3779B9 + (hash << 6) + (hash >> 2);
+            return hash;
+        }
+    };
+    std::unordered_map<VolumeEnergyKey, Double_t, VolumeEnergyKeyHash> fVolumeEnergies;
+
+#ifdef RESTG4_WITH_RNTUPLE
+    std::unique_ptr<RNTupleEventWriter::FillContext> fRNTupleFillContext{};  // created on first use
+#endif
+
+    // material scan totals of the current ray
+    std::map<const G4VPhysicalVolume*, Double_t> fMaterialScanPathLengths;
+    std::map<const G4Material*, Double_t> fMaterialScanArealDensities;
+
+    // pilot run, cells of the importance map visited by each track of the current event
+    struct PilotTrack {
+        Int_t fParentID = 0;
+        std::vector<Int_t> fCells;
+        bool fContributes = false;  // deposits energy in a sensitive volume
+    };
+    std::unordered_map<Int_t, PilotTrack> fPilotTracks;
+
+    // finished tracks of the current (sub)event that are still in memory. A track is released, to be removed
+    // on the next compaction, once it and all its descendants are done and none of them is to be kept
+    struct TrackLineage {
+        Int_t fParentID = 0;
+        Int_t fPendingSecondaries = 0;  // neither released nor killed at stacking
+        size_t fNumberOfSteps = 0;
+        bool fKeep = false;  // the track or one of its descendants has hits in a keep tracks volume
+    };
+    std::unordered_map<Int_t, TrackLineage> fTrackLineages;
+    std::unordered_set<Int_t> fReleasedTrackIDs;
+    size_t fReleasedSteps = 0;
+    // released tracks needed before a compaction, so small events are compacted at most once, at the end
+    static constexpr size_t fMinimumReleasedTracks = 256;
+    size_t fCurrentTrackFirstStep = 0;
+    bool fCurrentTrackKeep = false;
+
+    // sub-events of the current Geant4 event waiting to be grouped in time windows
+    std::vector<std::unique_ptr<TRestGeant4Event> > fPendingSubEvents;
+    size_t fNumberOfTriggers = 0;
+    size_t fNumberOfDeadTimeLosses = 0;  // sub-events with energy in the sensitive volume lost in dead time
+
+    // same order as the tallies of the simulation manager
+    std::vector<MeshTally::Grid> fMeshTallyGrids;
+    std::vector<SurfaceTally::Spectra> fSurfaceTallySpectra;
+    ActivationTally::Counts fActivationCounts;
+
+    void BuildHits();
+    void AddVolumeEnergies();
+    void UpdateTracksPerEventStatistics(size_t numberOfTracks);
+    size_t GetExpectedNumberOfTracks() const;
     void RemoveUnwantedTracks();
+    void KeepTrackLineage(Int_t trackID);
+    void ReleaseCompleteTracks(Int_t trackID);
+    void CompactReleasedTracks();
+    void SubmitEvent();
+    void OverlayLibraryEvents();
+    // adds the per volume, total and sensitive volume energies of another event to the current one
+    void AddEventEnergies(const TRestGeant4Event& event);
+    void MergeSubEvent(TRestGeant4Event& subEvent);
+    void SubmitMaterialScanRay();
+    void SubmitPilotEvent();
 
     friend class StackingAction;
 };
@@ -26,6 +26,8 @@ class StackingAction : public G4UserStackingAction {
     }
 
    private:
+    G4ClassificationOfNewTrack Classify(const G4Track*);
+
     SimulationManager* fSimulationManager;
     double fMaxAllowedLifetime;
     G4String fMaxAllowedLifetimeWithUnit;
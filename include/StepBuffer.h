@@ -0,0 +1,35 @@
+
+#ifndef REST_STEPBUFFER_H
+#define REST_STEPBUFFER_H
+
+#include <Rtypes.h>
+
+#include <unordered_set>
+#include <vector>
+
+// Steps recorded during the tracking of one (sub)event, one column per quantity. Values are stored in
+// Geant4 internal units and converted in a single pass when the hits are built at event submission.
+// Steps of the same track are contiguous since Geant4 tracks one particle at a time
+struct StepBuffer {
+    std::vector<Int_t> fTrackID;
+    std::vector<Double_t> fX;
+    std::vector<Double_t> fY;
+    std::vector<Double_t> fZ;
+    std::vector<Double_t> fEnergy;
+    std::vector<Double_t> fTime;  // only filled if the time hit field is stored
+    std::vector<Int_t> fProcessID;
+    std::vector<Int_t> fVolumeID;
+    // optional hit fields, only filled if they are stored
+    std::vector<Double_t> fKineticEnergy;
+    std::vector<Double_t> fDirectionX;
+    std::vector<Double_t> fDirectionY;
+    std::vector<Double_t> fDirectionZ;
+
+    inline size_t Size() const { return fTrackID.size(); }
+
+    void ConvertUnits();  // to mm, keV and us
+    void RemoveTracks(const std::unordered_set<Int_t>& trackIDs);  // keeps the order of the other steps
+    void Clear();
+};
+
+#endif  // REST_STEPBUFFER_H
@@ -11,6 +11,9 @@
 #include <globals.hh>
 #include <iostream>
 
+class G4StepPoint;
+class G4VPhysicalVolume;
+class OutputManager;
 class SimulationManager;
 
 class SteppingAction : public G4UserSteppingAction {
@@ -22,5 +25,12 @@ class SteppingAction : public G4UserSteppingAction {
 
    private:
     SimulationManager* fSimulationManager;
+    OutputManager* fOutputManager;  // actions are built on the thread that owns the output manager
+
+    // resolved on the first step since geometry may not be constructed when this action is created
+    const G4VPhysicalVolume* fPhaseSpaceVolume = nullptr;
+    bool fPhaseSpaceVolumeResolved = false;
+
+    bool IsInsidePhaseSpaceVolume(const G4StepPoint*) const;
 };
 #endif
@@ -0,0 +1,63 @@
+
+#ifndef REST_SURFACETALLY_H
+#define REST_SURFACETALLY_H
+
+#include <TVector2.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class G4ParticleDefinition;
+class G4Step;
+
+// Spectra of the particles crossing the boundary of a volume, per particle species, in kinetic energy (keV)
+// and cosine of the angle between the direction and the outward normal of the volume surface, so entering
+// particles have negative cosine. Counts are weighted by the track weight. Energies outside the range are
+// not counted. Each thread fills its own spectra, they are merged at the end of the run
+class SurfaceTally {
+   public:
+    struct Parameters {
+        std::string fVolume;
+        Int_t fEnergyBins = 100;
+        TVector2 fEnergyRange = {0, 10000};  // keV
+        bool fLogEnergy = false;
+        Int_t fAngleBins = 20;
+    };
+
+    class Spectra {
+       public:
+        explicit Spectra(const SurfaceTally& tally) : fTally(tally) {}
+
+        // step must cross the boundary of the volume, 'entering' tells in which direction
+        void Fill(const G4Step* step, bool entering);
+
+       private:
+        const SurfaceTally& fTally;
+        std::unordered_map<const G4ParticleDefinition*, std::vector<Double_t> > fCounts;
+
+        friend class SurfaceTally;
+    };
+
+    explicit SurfaceTally(const Parameters& parameters);
+
+    inline const std::string& GetVolume() const { return fParameters.fVolume; }
+
+    // Can be called concurrently from several threads
+    void Merge(const Spectra& spectra);
+
+    // Writes one histogram per particle into a 'SurfaceTallies/<volume>' directory of the current file
+    void Write();
+
+    std::string ToString() const;
+
+   private:
+    Parameters fParameters;
+
+    std::mutex fMutex;
+    std::map<std::string, std::vector<Double_t> > fCounts;  // by particle name
+};
+
+#endif  // REST_SURFACETALLY_H
@@ -0,0 +1,52 @@
+
+#ifndef REST_THREADCONTEXT_H
+#define REST_THREADCONTEXT_H
+
+#include <TString.h>
+
+#include <unordered_map>
+#include <vector>
+
+class G4VPhysicalVolume;
+class HitVoxelizer;
+class OutputManager;
+class SimulationManager;
+
+// Everything the step, track and event callbacks of one thread need, resolved once when the thread
+// processes its first event (geometry is available by then) and never modified afterwards
+struct ThreadContext {
+    struct Volume {
+        TString fName;  // name used by REST, not the Geant4 physical volume name
+        Int_t fID = -1;
+        bool fActive = false;
+        bool fKeepTracks = false;  // tracks with hits here and their ancestors survive track removal
+    };
+
+    ThreadContext(const SimulationManager* simulationManager, OutputManager* outputManager);
+
+    const Volume& GetVolume(const G4VPhysicalVolume* volume) const;
+
+    OutputManager* fOutputManager;
+    HitVoxelizer* fVoxelizer;
+
+    unsigned int fHitFields;
+    bool fRemoveZeroEnergyHits;
+    bool fMaterialScan;
+    bool fPilot;
+    bool fMeshTallies;
+    bool fActivationTally;
+
+    bool fSaveAllEvents;
+    bool fRemoveUnwantedTracks;
+    bool fKeepZeroEnergyTracks;
+    bool fStreamingTrackRemoval;  // unwanted tracks are released while the event is being tracked
+    Double_t fMinimumEnergyStored;
+    Double_t fMaximumEnergyStored;
+    Double_t fSimulationMaxTimeSeconds;
+
+    std::unordered_map<const G4VPhysicalVolume*, Volume> fVolumes;
+    // physical volumes of each surface tally, in the order of the surface tallies of the simulation manager
+    std::vector<std::vector<const G4VPhysicalVolume*> > fSurfaceTallyVolumes;
+};
+
+#endif  // REST_THREADCONTEXT_H
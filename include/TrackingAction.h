@@ -12,6 +12,7 @@
 
 class RunAction;
 class EventAction;
+class OutputManager;
 class SimulationManager;
 
 class TrackingAction : public G4UserTrackingAction {
@@ -24,6 +25,7 @@ class TrackingAction : public G4UserTrackingAction {
 
    private:
     SimulationManager* fSimulationManager;
+    OutputManager* fOutputManager;  // actions are built on the thread that owns the output manager
 };
 
 #endif
@@ -0,0 +1,80 @@
+
+#ifndef REST_VOXELTRAVERSAL_H
+#define REST_VOXELTRAVERSAL_H
+
+#include <Rtypes.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+// Visits, in order, the voxels of a regular grid crossed by the segment from 'origin' to 'origin + delta',
+// with coordinates relative to the lower corner of the grid (Amanatides and Woo). 'visit(index, fraction)'
+// receives the 3D index of each voxel and the fraction of the segment inside it. Parts of the segment outside
+// of the grid are skipped. The segment must not be null
+template <typename Visitor>
+void TraverseVoxels(const Double_t origin[3], const Double_t delta[3], const Double_t voxelSize[3],
+                    const Int_t bins[3], Visitor&& visit) {
+    // part of the segment (parameter t in [0, 1]) inside the grid
+    Double_t tEnter = 0;
+    Double_t tExit = 1;
+    for (int i = 0; i < 3; i++) {
+        const Double_t boxSize = voxelSize[i] * bins[i];
+        if (delta[i] == 0) {
+            if (origin[i] < 0 || origin[i] >= boxSize) {
+                return;
+            }
+            continue;
+        }
+        Double_t t0 = -origin[i] / delta[i];
+        Double_t t1 = (boxSize - origin[i]) / delta[i];
+        if (t0 > t1) {
+            std::swap(t0, t1);
+        }
+        tEnter = std::max(tEnter, t0);
+        tExit = std::min(tExit, t1);
+    }
+    if (tEnter >= tExit) {
+        return;
+    }
+
+    Int_t index[3];
+    Int_t step[3];
+    Double_t tNext[3];
+    Double_t tDelta[3];
+    for (int i = 0; i < 3; i++) {
+        const Double_t position = origin[i] + tEnter * delta[i];
+        index[i] = std::min(std::max(Int_t(std::floor(position / voxelSize[i])), 0), bins[i] - 1);
+        if (delta[i] > 0) {
+            step[i] = 1;
+            tNext[i] = ((index[i] + 1) * voxelSize[i] - origin[i]) / delta[i];
+            tDelta[i] = voxelSize[i] / delta[i];
+        } else if (delta[i] < 0) {
+            step[i] = -1;
+            tNext[i] = (index[i] * voxelSize[i] - origin[i]) / delta[i];
+            tDelta[i] = -voxelSize[i] / delta[i];
+        } else {
+            step[i] = 0;
+            tNext[i] = std::numeric_limits<Double_t>::infinity();
+            tDelta[i] = std::numeric_limits<Double_t>::infinity();
+        }
+    }
+
+    Double_t t = tEnter;
+    while (t < tExit) {
+        const int axis = tNext[0] < tNext[1] ? (tNext[0] < tNext[2] ? 0 : 2) : (tNext[1] < tNext[2] ? 1 : 2);
+        const Double_t tLeave = std::min(tNext[axis], tExit);
+
+        visit(static_cast<const Int_t*>(index), tLeave - t);
+
+        t = tLeave;
+        index[axis] += step[axis];
+        if (index[axis] < 0 || index[axis] >= bins[axis]) {
+            break;
+        }
+        tNext[axis] += tDelta[axis];
+    }
+}
+
+#endif  // REST_VOXELTRAVERSAL_H
@@ -0,0 +1,70 @@
+
+#include "ActivationTally.h"
+
+#include <TDirectory.h>
+#include <TTree.h>
+
+#include <G4HadronicProcessType.hh>
+#include <G4Ions.hh>
+#include <G4SystemOfUnits.hh>
+#include <G4Track.hh>
+#include <G4VProcess.hh>
+#include <iostream>
+
+using namespace std;
+
+bool ActivationTally::IsProducedIsotope(const G4Track* track) {
+    const auto process = track->GetCreatorProcess();
+    return process != nullptr && process->GetProcessType() == fHadronic &&
+           process->GetProcessSubType() != fHadronElastic &&
+           track->GetParticleDefinition()->GetParticleType() == "nucleus";
+}
+
+void ActivationTally::Counts::Fill(const string& volume, const G4Track* track) {
+    const auto ion = static_cast<const G4Ions*>(track->GetParticleDefinition());
+    auto& production = fProductions[make_tuple(volume, ion->GetAtomicNumber(), ion->GetAtomicMass(),
+                                               ion->GetExcitationEnergy() / CLHEP::keV)];
+    production.fCount++;
+    production.fWeight += track->GetWeight();
+}
+
+void ActivationTally::Merge(const Counts& counts) {
+    lock_guard<mutex> guard(fMutex);
+    for (const auto& [isotope, production] : counts.fProductions) {
+        auto& mergedProduction = fProductions[isotope];
+        mergedProduction.fCount += production.fCount;
+        mergedProduction.fWeight += production.fWeight;
+    }
+}
+
+void ActivationTally::Write() {
+    lock_guard<mutex> guard(fMutex);
+
+    TDirectory* previousDirectory = gDirectory;
+    gDirectory->mkdir("ActivationTally", "", true)->cd();
+
+    string volume;
+    Int_t z, a;
+    Double_t excitationEnergy, weight;
+    Long64_t count;
+
+    TTree tree("Isotopes", "Isotopes produced per volume");
+    tree.SetDirectory(nullptr);
+    tree.Branch("volume", &volume);
+    tree.Branch("Z", &z);
+    tree.Branch("A", &a);
+    tree.Branch("excitationEnergy", &excitationEnergy);  // keV
+    tree.Branch("count", &count);
+    tree.Branch("weight", &weight);
+
+    for (const auto& [isotope, production] : fProductions) {
+        tie(volume, z, a, excitationEnergy) = isotope;
+        count = production.fCount;
+        weight = production.fWeight;
+        tree.Fill();
+    }
+    tree.Write(nullptr, TObject::kOverwrite);
+
+    cout << "Activation tally: " << fProductions.size() << " isotope productions written" << endl;
+    previousDirectory->cd();
+}
@@ -2,6 +2,7 @@
 #include "Application.h"
 
 #include <TGeoManager.h>
+#include <TNamed.h>
 #include <TObjArray.h>
 #include <TObjString.h>
 #include <TPRegexp.h>
@@ -23,8 +24,10 @@
 #include "ActionInitialization.h"
 #include "DetectorConstruction.h"
 #include "EventAction.h"
+#include "GDMLCache.h"
 #include "PhysicsList.h"
 #include "PrimaryGeneratorAction.h"
+#include "RandomEngine.h"
 #include "RunAction.h"
 #include "SimulationManager.h"
 #include "SteppingAction.h"
@@ -63,6 +66,12 @@ void ShowUsage() {
          << "\t--interactive (-i) | set interactive mode (disabled by default)" << endl
          << "\t--threads (-t, -j) | set the number of threads, also enables multithreading which is disabled "
             "by default"
+         << endl
+         << "\t--rng engine | random number engine (" << RandomEngine::GetAvailableNames() << ")" << endl
+         << "\t--rng-benchmark | report the speed of the random engine and its share of the simulation time"
+         << endl
+         << "\t--pilot importance.root | pilot run, writes an importance map of the mesh cells for the "
+            "sensitive volume deposits"
          << endl;
 }
 
@@ -71,6 +80,7 @@ void PrintOptions(const Options& options) {
          << "\t- RML file: " << options.rmlFile << endl
          << (!options.outputFile.empty() ? "\t- Output file: " + options.outputFile + "\n" : "")
          << (!options.geometryFile.empty() ? "\t- Geometry file: " + options.geometryFile + "\n" : "")
+         << (!options.pilotFile.empty() ? "\t- Pilot run importance map: " + options.pilotFile + "\n" : "")
          << (options.interactive ? "\t- Interactive: True\n" : "")  //
          << "\t- Execution mode: "
          << (options.nThreads == 0 ? "serial\n"
@@ -78,6 +88,8 @@ void PrintOptions(const Options& options) {
          << (options.nEvents != 0 ? "\t- Number of generated events: " + to_string(options.nEvents) + "\n"
                                   : "")
          << (options.seed != 0 ? "\t- Random seed: " + to_string(options.seed) + "\n" : "")
+         << (!options.randomEngine.empty() ? "\t- Random engine: " + options.randomEngine + "\n" : "")
+         << (options.randomBenchmark ? "\t- Random engine benchmark: True\n" : "")
          << (options.nRequestedEntries != 0
                  ? "\t- Number of requested entries: " + to_string(options.nRequestedEntries) + "\n"
                  : "")
@@ -165,6 +177,24 @@ Options ProcessCommandLineOptions(int argc, char* const argv[]) {
                 cerr << "--geometry option requires one argument" << endl;
                 exit(1);
             }
+        } else if (arg == "--rng") {
+            if (i + 1 < argc) {  // Make sure we aren't at the end of argv!
+                options.randomEngine =
+                    argv[++i];  // Increment 'i' so we don't get the argument as the next argv[i].
+            } else {
+                cerr << "--rng option requires one argument" << endl;
+                exit(1);
+            }
+        } else if (arg == "--rng-benchmark") {
+            options.randomBenchmark = true;
+        } else if (arg == "--pilot") {
+            if (i + 1 < argc) {  // Make sure we aren't at the end of argv!
+                options.pilotFile =
+                    argv[++i];  // Increment 'i' so we don't get the argument as the next argv[i].
+            } else {
+                cerr << "--pilot option requires one argument" << endl;
+                exit(1);
+            }
         } else if ((arg == "-i") || (arg == "--interactive")) {
             options.interactive = true;
             // TODO: not yet implemented
@@ -322,17 +352,37 @@ void Application::Run(const CommandLineOptions::Options& options) {
     // 3. We retrieve the GDML and materials versions and associate to the
     // corresponding TRestGeant4Metadata members
     // 4. We support the use of system variables ${}
-    auto gdml = new TRestGDMLParser();
+    // Processed geometries can be cached, so that many jobs only fetch and process them once
+    unique_ptr<GDMLCache> gdmlCache;
+    const string gdmlCacheDirectory = metadata->GetParameter("gdmlCacheDirectory", "");
+    if (!gdmlCacheDirectory.empty()) {
+        gdmlCache = make_unique<GDMLCache>(gdmlCacheDirectory,
+                                           StringToBool(metadata->GetParameter("gdmlCacheOffline", "false")));
+    }
+
+    const string gdmlFilename = (string)metadata->GetGdmlFilename();
+    TRestGDMLParser* gdml = nullptr;
+    GDMLCache::Entry gdmlCacheEntry;
+    if (!gdmlCache || !gdmlCache->Lookup(gdmlFilename, gdmlCacheEntry)) {
+        gdml = new TRestGDMLParser();
 
-    // This call will generate a new single file GDML output
-    gdml->Load((string)metadata->GetGdmlFilename());
+        // This call will generate a new single file GDML output
+        gdml->Load(gdmlFilename);
+
+        gdmlCacheEntry.fGdmlFilename = gdml->GetOutputGDMLFile();
+        gdmlCacheEntry.fGdmlVersion = gdml->GetGDMLVersion();
+        gdmlCacheEntry.fMaterialsVersion = gdml->GetEntityVersion("materials");
+        if (gdmlCache) {
+            gdmlCache->Store(gdmlFilename, gdmlCacheEntry);
+        }
+    }
 
     // We redefine the value of the GDML file to be used in DetectorConstructor.
-    metadata->SetGdmlFilename(gdml->GetOutputGDMLFile());
+    metadata->SetGdmlFilename(gdmlCacheEntry.fGdmlFilename);
     metadata->SetGeometryPath("");
 
-    metadata->SetGdmlReference(gdml->GetGDMLVersion());
-    metadata->SetMaterialsReference(gdml->GetEntityVersion("materials"));
+    metadata->SetGdmlReference(gdmlCacheEntry.fGdmlVersion);
+    metadata->SetMaterialsReference(gdmlCacheEntry.fMaterialsVersion);
 
     auto physicsLists = new TRestGeant4PhysicsLists(inputRmlClean.c_str());
     fSimulationManager.SetRestPhysicsLists(physicsLists);
@@ -370,10 +420,36 @@ void Application::Run(const CommandLineOptions::Options& options) {
 
     run->AddEventBranch(&fSimulationManager.fEvent);
 
-    // choose the Random engine
-    CLHEP::HepRandom::setTheEngine(new CLHEP::RanecuEngine);
+    fSimulationManager.InitializeHitStorageOptions();
+    fSimulationManager.InitializeEventCompression();
+    fSimulationManager.InitializeRNTupleOutput();
+    fSimulationManager.InitializeVoxelization();
+    fSimulationManager.InitializeElectronDrift();
+    fSimulationManager.InitializePhaseSpace();
+    fSimulationManager.InitializeEventOverlay();
+    fSimulationManager.InitializeDecayLibrary();
+    fSimulationManager.InitializeMaterialScan();
+    fSimulationManager.InitializeFastSimulation();
+    fSimulationManager.InitializePilot(options.pilotFile);
+    fSimulationManager.InitializeMeshTallies();
+    fSimulationManager.InitializeSurfaceTallies();
+    fSimulationManager.InitializeActivationTally();
+    fSimulationManager.InitializeEventBuilding();
+
+    // choose the Random engine, the CLI option overrides the RML
+    const string randomEngineName = !options.randomEngine.empty()
+                                        ? options.randomEngine
+                                        : metadata->GetParameter("randomEngine", "ranecu");
+    const bool randomBenchmark =
+        options.randomBenchmark || StringToBool(metadata->GetParameter("randomBenchmark", "false"));
+    CLHEP::HepRandomEngine* randomEngine = RandomEngine::Create(randomEngineName);
+    if (randomBenchmark) {
+        randomEngine = new CountingRandomEngine(randomEngine);
+    }
+    CLHEP::HepRandom::setTheEngine(randomEngine);
     long seed = metadata->GetSeed();
     CLHEP::HepRandom::setTheSeed(seed);
+    cout << "Random engine: " << randomEngineName << endl;
 
     G4VSteppingVerbose::SetInstance(new SteppingVerbose(&fSimulationManager));
 
@@ -393,6 +469,7 @@ void Application::Run(const CommandLineOptions::Options& options) {
     if (!serialMode) {
         ROOT::EnableThreadSafety();
         runManager->SetNumberOfThreads(options.nThreads);
+        runManager->SetUserInitialization(new WorkerThreadInitialization(randomEngineName, randomBenchmark));
     }
 #else
     cout << "Using serial run manager" << endl;
@@ -402,7 +479,11 @@ void Application::Run(const CommandLineOptions::Options& options) {
     fSimulationManager.InitializeUserDistributions();
 
     runManager->SetUserInitialization(new DetectorConstruction(&fSimulationManager));
-    runManager->SetUserInitialization(new PhysicsList(fSimulationManager.GetRestPhysicsLists()));
+    auto physicsList = new PhysicsList(fSimulationManager.GetRestPhysicsLists());
+    if (!fSimulationManager.GetFastSimulationRegions().empty()) {
+        physicsList->EnableFastSimulation();
+    }
+    runManager->SetUserInitialization(physicsList);
     fSimulationManager.GetRestPhysicsLists()->PrintMetadata();
     runManager->SetUserInitialization(new ActionInitialization(&fSimulationManager));
 
@@ -427,13 +508,22 @@ void Application::Run(const CommandLineOptions::Options& options) {
     run->UpdateOutputFile();
 
     cout << "Writing geometry" << endl;
-    gdml->CreateGeoManager();
+    if (gdml != nullptr) {
+        gdml->CreateGeoManager();
+    } else {
+        // cached geometry is already processed
+        TGeoManager::Import(gdmlCacheEntry.fGdmlFilename.c_str());
+    }
     if (!gGeoManager) {
         cout << "Writing geometry - Error - Unable to write geometry (geometry not found)" << endl;
         exit(1);
     }
     gGeoManager->Write(geometryName, TObject::kOverwrite);
 
+    // Schema of the stored hits, optional columns not listed here are empty
+    TNamed(HitFields::ObjectName, HitFields::ToString(fSimulationManager.GetHitFields()))
+        .Write(HitFields::ObjectName, TObject::kOverwrite);
+
     signal(SIGINT, (void (*)(int))interruptSignalHandler);  // Add custom signal handler before simulation
 
     cout << "Number of events: " << nEvents << endl;
@@ -442,6 +532,22 @@ void Application::Run(const CommandLineOptions::Options& options) {
         UI->ApplyCommand("/tracking/verbose 0");
         UI->ApplyCommand("/run/initialize");
         UI->ApplyCommand("/run/beamOn " + to_string(nEvents));
+
+        if (randomBenchmark) {
+            const double numbersPerSecond = RandomEngine::Benchmark(randomEngineName, 100000000);
+            const auto numbersDrawn = CountingRandomEngine::GetTotalCount();
+            // all threads are busy during the run
+            const double simulationTime =
+                fSimulationManager.GetElapsedTime() * (options.nThreads > 0 ? options.nThreads : 1);
+            const double randomTime = numbersPerSecond > 0 ? numbersDrawn / numbersPerSecond : 0;
+            const auto numberOfEvents = metadata->GetNumberOfEvents();
+            const double numbersPerEvent = numberOfEvents > 0 ? double(numbersDrawn) / numberOfEvents : 0;
+            cout << "Random engine '" << randomEngineName << "': " << numbersPerSecond
+                 << " random numbers per second. The simulation drew " << numbersDrawn << " random numbers ("
+                 << numbersPerEvent << " per event), about "
+                 << (simulationTime > 0 ? 100 * randomTime / simulationTime : 0) << "% of the simulation time"
+                 << endl;
+        }
     }
 
     else if (nEvents == 0)  // define visualization and UI terminal for interactive mode
@@ -473,6 +579,9 @@ void Application::Run(const CommandLineOptions::Options& options) {
 
     const auto nEntries = run->GetEntries();
 
+    run->GetOutputFile()->cd();
+    fSimulationManager.WriteAuxiliaryOutput();
+
     run->UpdateOutputFile();
     run->CloseFile();
 
@@ -522,6 +631,9 @@ void Application::ValidateOutputFile(const string& filename) const {
     map<string, int> metadataCount;
     for (const auto& obj : *file->GetListOfKeys()) {
         const auto key = dynamic_cast<TKey*>(obj);
+        if (TString(key->GetClassName()) == "TTree" && TString(key->GetName()) != "EventTree") {
+            continue;  // auxiliary trees such as 'VoxelTree' or 'ReadoutSignalTree'
+        }
         metadataCount[key->GetClassName()]++;
     }
     for (const auto name : {"TRestGeant4Metadata", "TRestGeant4PhysicsLists", "TRestRun", "TRestAnalysisTree",
@@ -1,9 +1,13 @@
 
 #include <G4Event.hh>
+#include <G4Geantino.hh>
 #include <G4HadronicProcess.hh>
 #include <G4Nucleus.hh>
 #include <G4Threading.hh>
 #include <Randomize.hh>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 #include "SimulationManager.h"
 #include "SteppingAction.h"
@@ -50,11 +54,7 @@ TRestGeant4Event::TRestGeant4Event(const G4Event* event) : TRestGeant4Event() {
 }
 
 bool TRestGeant4Event::InsertTrack(const G4Track* track) {
-    if (fInitialStep.GetNumberOfHits() != 1) {
-        cout << "fInitialStep does not have exactly one step! Problem with stepping verbose" << endl;
-        exit(1);
-    }
-
+    // the initial step of the track is checked by the caller (OutputManager::RecordTrack)
     if (fTracks.empty() && IsSubEvent()) {
         // First track of sub-event (primary)
         fSubEventPrimaryParticleName = track->GetParticleDefinition()->GetParticleName();
@@ -72,7 +72,10 @@ bool TRestGeant4Event::InsertTrack(const G4Track* track) {
 
     auto& insertedTrack = fTracks.back();
 
-    insertedTrack.SetHits(fInitialStep);
+    // hits are built from the step buffer when the event is submitted
+    TRestGeant4Hits hits;
+    hits.SetEvent(this);
+    insertedTrack.SetHits(hits);
     insertedTrack.SetEvent(this);
 
     TRestGeant4Track* parentTrack = GetTrackByID(track->GetParentID());
@@ -86,14 +89,9 @@ bool TRestGeant4Event::InsertTrack(const G4Track* track) {
 void TRestGeant4Event::UpdateTrack(const G4Track* track) { fTracks.back().UpdateTrack(track); }
 
 void TRestGeant4Event::InsertStep(const G4Step* step) {
-    if (step->GetTrack()->GetCurrentStepNumber() == 0) {
-        // initial step (from SteppingVerbose) is generated before TrackingAction can insert the first track
-        fInitialStep = TRestGeant4Hits();
-        fInitialStep.SetEvent(this);
-        fInitialStep.InsertStep(step);
-    } else {
-        fTracks.back().InsertStep(step);
-    }
+    // initial step (from SteppingVerbose) is generated before TrackingAction can insert the track, the step
+    // buffer is indexed by track ID so it does not matter
+    SimulationManager::GetOutputManager()->BufferStep(step);
 }
 
 bool OutputManager::IsValidTrack(const G4Track*) const { return true; }
@@ -127,8 +125,6 @@ TRestGeant4Track::TRestGeant4Track(const G4Track* track) : TRestGeant4Track() {
     fInitialPosition = {trackOrigin.x(), trackOrigin.y(), trackOrigin.z()};
 }
 
-void TRestGeant4Track::InsertStep(const G4Step* step) { fHits.InsertStep(step); }
-
 void TRestGeant4Track::UpdateTrack(const G4Track* track) {
     if (track->GetTrackID() != fTrackID) {
         G4cout << "Geant4Track::UpdateTrack - mismatch of trackID!" << endl;
@@ -143,65 +139,184 @@ Int_t TRestGeant4PhysicsInfo::GetProcessIDFromGeant4Process(const G4VProcess* pr
     return process->GetProcessType() * 1000 + process->GetProcessSubType();
 }
 
-void TRestGeant4Hits::InsertStep(const G4Step* step) {
-    const G4Track* track = step->GetTrack();
+Int_t OutputManager::GetParticleID(const G4ParticleDefinition* particle) {
+    const auto it = fParticleIDs.find(particle);
+    if (it != fParticleIDs.end()) {
+        return it->second;
+    }
+    const Int_t particleID = particle->GetPDGEncoding();
+    auto& physicsInfo = fSimulationManager->GetRestMetadata()->fGeant4PhysicsInfo;
+    physicsInfo.InsertParticleName(particleID, particle->GetParticleName());
+    fParticleIDs[particle] = particleID;
+    return particleID;
+}
 
-    TRestGeant4Metadata* metadata = GetGeant4Metadata();
+Int_t OutputManager::GetProcessID(const G4VProcess* process) {
+    const auto it = fProcessIDs.find(process);
+    if (it != fProcessIDs.end()) {
+        return it->second;
+    }
+    auto& physicsInfo = fSimulationManager->GetRestMetadata()->fGeant4PhysicsInfo;
+    Int_t processID = 0;
+    if (process != nullptr) {
+        processID = TRestGeant4PhysicsInfo::GetProcessIDFromGeant4Process(process);
+        physicsInfo.InsertProcessName(processID, process->GetProcessName(),
+                                      G4VProcess::GetProcessTypeName(process->GetProcessType()));
+    } else {
+        physicsInfo.InsertProcessName(processID, "Init", "Init");
+    }
+    fProcessIDs[process] = processID;
+    return processID;
+}
 
-    const auto& geometryInfo = metadata->GetGeant4GeometryInfo();
+void OutputManager::BufferStep(const G4Step* step) {
+    const G4Track* track = step->GetTrack();
+    const auto stepNumber = track->GetCurrentStepNumber();
+
+    const ThreadContext& context = *fContext;
+    const auto hitFields = context.fHitFields;
 
-    const auto& volumeNameGeant4 = step->GetPreStepPoint()->GetPhysicalVolume()->GetName();
-    const auto& volumeName = geometryInfo.GetAlternativeNameFromGeant4PhysicalName(volumeNameGeant4);
+    const auto& volume = context.GetVolume(step->GetPreStepPoint()->GetPhysicalVolume());
 
-    if (!metadata->IsActiveVolume(volumeName) && step->GetTrack()->GetCurrentStepNumber() != 0) {
+    if (!volume.fActive && stepNumber != 0) {
         // we always store the first step
         return;
     }
 
-    const auto& particle = step->GetTrack()->GetDefinition();
-    const auto& particleID = particle->GetPDGEncoding();
-    const auto& particleName = particle->GetParticleName();
+    const auto energyDeposit = step->GetTotalEnergyDeposit();
 
-    metadata->fGeant4PhysicsInfo.InsertParticleName(particleID, particleName);
+    const auto& particle = track->GetDefinition();
 
-    const auto process = step->GetPostStepPoint()->GetProcessDefinedStep();
-    G4String processName = "Init";
-    G4String processTypeName = "Init";
-    Int_t processID = 0;
-    if (track->GetCurrentStepNumber() != 0) {
-        // 0 = Init step (G4SteppingVerbose) process is not defined for this step
-        processName = process->GetProcessName();
-        processTypeName = G4VProcess::GetProcessTypeName(process->GetProcessType());
-        processID = TRestGeant4PhysicsInfo::GetProcessIDFromGeant4Process(process);
+    if (energyDeposit <= 0 && context.fRemoveZeroEnergyHits && stepNumber > 1 &&
+        track->GetTrackStatus() == fAlive && particle != G4Geantino::Definition()) {
+        // transport step without energy deposit, the first and last steps of the track are kept for topology
+        return;
     }
 
-    metadata->fGeant4PhysicsInfo.InsertProcessName(processID, processName, processTypeName);
+    GetParticleID(particle);
 
-    const auto energy = step->GetTotalEnergyDeposit() / CLHEP::keV;
-    const auto trackKineticEnergy = step->GetTrack()->GetKineticEnergy() / CLHEP::keV;
+    // 0 = Init step (G4SteppingVerbose) process is not defined for this step
+    const auto process = stepNumber != 0 ? step->GetPostStepPoint()->GetProcessDefinedStep() : nullptr;
+    const Int_t processID = GetProcessID(process);
 
-    auto sensitiveVolumeName =
-        geometryInfo.GetAlternativeNameFromGeant4PhysicalName(metadata->GetSensitiveVolume());
+    const auto energy = energyDeposit / CLHEP::keV;
+    const G4ThreeVector& position = track->GetPosition();
 
-    G4Track* aTrack = step->GetTrack();
+    if (context.fVoxelizer != nullptr && stepNumber != 0) {
+        // energy goes into the readout grid instead of the hits, only the initial step of the track is kept
+        if (energy > 0) {
+            const TVector3 hitPosition = {position.x() / CLHEP::mm, position.y() / CLHEP::mm,
+                                          position.z() / CLHEP::mm};
+            context.fVoxelizer->Fill(hitPosition, energy);
+        }
+    } else {
+        // raw Geant4 units, converted in BuildHits
+        fStepBuffer.fTrackID.push_back(track->GetTrackID());
+        fStepBuffer.fX.push_back(position.x());
+        fStepBuffer.fY.push_back(position.y());
+        fStepBuffer.fZ.push_back(position.z());
+        fStepBuffer.fEnergy.push_back(energyDeposit);
+        if (hitFields & HitFields::Time) {
+            fStepBuffer.fTime.push_back(step->GetPreStepPoint()->GetGlobalTime());
+        }
+        fStepBuffer.fProcessID.push_back(processID);
+        fStepBuffer.fVolumeID.push_back(volume.fID);
+        if (volume.fKeepTracks && (energyDeposit > 0 || context.fKeepZeroEnergyTracks)) {
+            fCurrentTrackKeep = true;
+        }
+        if (hitFields & HitFields::KineticEnergy) {
+            fStepBuffer.fKineticEnergy.push_back(track->GetKineticEnergy());
+        }
+        if (hitFields & HitFields::MomentumDirection) {
+            const G4ThreeVector& momentum = step->GetPreStepPoint()->GetMomentumDirection();
+            fStepBuffer.fDirectionX.push_back(momentum.x());
+            fStepBuffer.fDirectionY.push_back(momentum.y());
+            fStepBuffer.fDirectionZ.push_back(momentum.z());
+        }
+    }
 
-    Double_t x = aTrack->GetPosition().x() / CLHEP::mm;
-    Double_t y = aTrack->GetPosition().y() / CLHEP::mm;
-    Double_t z = aTrack->GetPosition().z() / CLHEP::mm;
+    fVolumeEnergies[{&volume, particle, process}] += energy;
+}
 
-    const TVector3 hitPosition(x, y, z);
-    const Double_t hitGlobalTime = step->GetPreStepPoint()->GetGlobalTime() / CLHEP::microsecond;
-    const G4ThreeVector& momentum = step->GetPreStepPoint()->GetMomentumDirection();
+void OutputManager::AddVolumeEnergies() {
+    for (const auto& [key, energy] : fVolumeEnergies) {
+        const auto& [volume, particle, process] = key;
+        const char* processName = process != nullptr ? process->GetProcessName().c_str() : "Init";
+        AddEnergyToVolumeForParticleForProcess(energy, volume->fName, particle->GetParticleName().c_str(),
+                                               processName);
+    }
+    fVolumeEnergies.clear();
+}
+
+void OutputManager::BuildHits() {
+    const auto hitFields = fContext->fHitFields;
+
+    fStepBuffer.ConvertUnits();
+
+    TRestGeant4Hits* hits = nullptr;
+    Int_t currentTrackID = 0;
+    for (size_t i = 0; i < fStepBuffer.Size(); i++) {
+        if (hits == nullptr || fStepBuffer.fTrackID[i] != currentTrackID) {
+            currentTrackID = fStepBuffer.fTrackID[i];
+            TRestGeant4Track* track = fEvent->GetTrackByID(currentTrackID);
+            hits = track != nullptr ? &track->fHits : nullptr;
+            if (hits == nullptr) {
+                continue;
+            }
+            // the number of hits of the track is known here, so all columns grow at most once
+            size_t end = i + 1;
+            while (end < fStepBuffer.Size() && fStepBuffer.fTrackID[end] == currentTrackID) {
+                end++;
+            }
+            const size_t capacity = hits->fX.size() + (end - i);
+            hits->fX.reserve(capacity);
+            hits->fY.reserve(capacity);
+            hits->fZ.reserve(capacity);
+            hits->fT.reserve(capacity);
+            hits->fEnergy.reserve(capacity);
+            hits->fType.reserve(capacity);
+            hits->fProcessID.reserve(capacity);
+            hits->fVolumeID.reserve(capacity);
+            hits->fKineticEnergy.reserve(capacity);
+            hits->fMomentumDirection.reserve(capacity);
+        }
 
-    AddHit(hitPosition, energy, hitGlobalTime);  // this increases fNHits
+        // columns not selected keep one placeholder per hit, so the 'TRestGeant4Hits' accessors stay in range
+        const Double_t time = (hitFields & HitFields::Time) ? fStepBuffer.fTime[i] : 0;
+        hits->AddHit({fStepBuffer.fX[i], fStepBuffer.fY[i], fStepBuffer.fZ[i]}, fStepBuffer.fEnergy[i], time);
+        hits->fProcessID.emplace_back(fStepBuffer.fProcessID[i]);
+        hits->fVolumeID.emplace_back(fStepBuffer.fVolumeID[i]);
+        if (hitFields & HitFields::KineticEnergy) {
+            hits->fKineticEnergy.emplace_back(fStepBuffer.fKineticEnergy[i]);
+        } else {
+            hits->fKineticEnergy.emplace_back(HitFields::UnsetKineticEnergy);
+        }
+        if (hitFields & HitFields::MomentumDirection) {
+            hits->fMomentumDirection.emplace_back(fStepBuffer.fDirectionX[i], fStepBuffer.fDirectionY[i],
+                                                  fStepBuffer.fDirectionZ[i]);
+        } else {
+            hits->fMomentumDirection.emplace_back(0, 0, 0);
+        }
+    }
 
-    fProcessID.emplace_back(processID);
-    fVolumeID.emplace_back(geometryInfo.GetIDFromVolume(volumeName));
-    fKineticEnergy.emplace_back(trackKineticEnergy);
-    fMomentumDirection.emplace_back(momentum.x(), momentum.y(), momentum.z());
+    fStepBuffer.Clear();
+}
+
+void OutputManager::UpdateTracksPerEventStatistics(size_t numberOfTracks) {
+    // Welford's online algorithm
+    fTracksPerEventSamples++;
+    const Double_t delta = Double_t(numberOfTracks) - fTracksPerEventMean;
+    fTracksPerEventMean += delta / fTracksPerEventSamples;
+    fTracksPerEventM2 += delta * (Double_t(numberOfTracks) - fTracksPerEventMean);
+}
 
-    SimulationManager::GetOutputManager()->AddEnergyToVolumeForParticleForProcess(energy, volumeName,
-                                                                                  particleName, processName);
+size_t OutputManager::GetExpectedNumberOfTracks() const {
+    if (fTracksPerEventSamples < 2) {
+        return size_t(fTracksPerEventMean);
+    }
+    // mean plus two standard deviations covers most events without reserving for the rare large showers
+    const Double_t sigma = sqrt(fTracksPerEventM2 / (fTracksPerEventSamples - 1));
+    return size_t(ceil(fTracksPerEventMean + 2 * sigma));
 }
 
 void OutputManager::RemoveUnwantedTracks() {
@@ -254,3 +369,243 @@ void OutputManager::RemoveUnwantedTracks() {
          << " tracks out of " << numberOfTracksBefore << endl;
      */
 }
+
+void OutputManager::FinishTrackLineage(const G4Track* track, size_t numberOfSecondaries) {
+    const Int_t trackID = track->GetTrackID();
+    auto& lineage = fTrackLineages[trackID];
+    lineage.fParentID = track->GetParentID();
+    lineage.fPendingSecondaries += Int_t(numberOfSecondaries);
+    lineage.fNumberOfSteps += fStepBuffer.Size() - fCurrentTrackFirstStep;
+
+    // steps of a suspended track are not contiguous, it is left for RemoveUnwantedTracks
+    if (fCurrentTrackKeep || track->GetTrackStatus() == fSuspend) {
+        KeepTrackLineage(trackID);
+    } else {
+        ReleaseCompleteTracks(trackID);
+    }
+    fCurrentTrackKeep = false;
+}
+
+void OutputManager::ResolveKilledSecondary(Int_t parentID) {
+    const auto parent = fTrackLineages.find(parentID);
+    if (parent == fTrackLineages.end()) {
+        return;
+    }
+    parent->second.fPendingSecondaries--;
+    ReleaseCompleteTracks(parentID);
+}
+
+void OutputManager::KeepTrackLineage(Int_t trackID) {
+    auto lineage = fTrackLineages.find(trackID);
+    while (lineage != fTrackLineages.end() && !lineage->second.fKeep) {
+        lineage->second.fKeep = true;
+        lineage = fTrackLineages.find(lineage->second.fParentID);
+    }
+}
+
+void OutputManager::ReleaseCompleteTracks(Int_t trackID) {
+    auto lineage = fTrackLineages.find(trackID);
+    while (lineage != fTrackLineages.end() && !lineage->second.fKeep &&
+           lineage->second.fPendingSecondaries == 0) {
+        const Int_t parentID = lineage->second.fParentID;
+        fReleasedTrackIDs.insert(lineage->first);
+        fReleasedSteps += lineage->second.fNumberOfSteps;
+        fTrackLineages.erase(lineage);
+
+        // the parent may now be complete too
+        lineage = fTrackLineages.find(parentID);
+        if (lineage != fTrackLineages.end()) {
+            lineage->second.fPendingSecondaries--;
+        }
+    }
+
+    // compaction is linear in the size of the event, only done when it at least halves the tracks or steps
+    const size_t releasedTracks = fReleasedTrackIDs.size();
+    if (releasedTracks >= fMinimumReleasedTracks &&
+        (2 * releasedTracks >= fEvent->fTracks.size() || 2 * fReleasedSteps >= fStepBuffer.Size())) {
+        CompactReleasedTracks();
+    }
+}
+
+void OutputManager::CompactReleasedTracks() {
+    fStepBuffer.RemoveTracks(fReleasedTrackIDs);
+
+    auto& tracks = fEvent->fTracks;
+    tracks.erase(remove_if(tracks.begin(), tracks.end(),
+                           [this](const TRestGeant4Track& track) {
+                               return fReleasedTrackIDs.count(track.GetTrackID()) > 0;
+                           }),
+                 tracks.end());
+    fEvent->fTrackIDToTrackIndex.clear();
+    for (int i = 0; i < int(tracks.size()); i++) {
+        fEvent->fTrackIDToTrackIndex[tracks[i].GetTrackID()] = i;
+    }
+
+    fReleasedTrackIDs.clear();
+    fReleasedSteps = 0;
+}
+
+void OutputManager::AddEventEnergies(const TRestGeant4Event& event) {
+    // also accumulates the total deposited energy
+    for (const auto& [volumeName, particles] : event.fEnergyInVolumePerParticlePerProcess) {
+        for (const auto& [particleName, processes] : particles) {
+            for (const auto& [processName, energy] : processes) {
+                fEvent->AddEnergyInVolumeForParticleForProcess(energy, volumeName, particleName, processName);
+            }
+        }
+    }
+    fEvent->AddEnergyToSensitiveVolume(event.GetSensitiveVolumeEnergy());
+}
+
+void OutputManager::OverlayLibraryEvents() {
+    const auto& library = fSimulationManager->GetOverlayLibrary();
+    const double timeWindow = fSimulationManager->GetOverlayTimeWindow();
+    const TVector3& translationBox = fSimulationManager->GetOverlayTranslation();
+
+    const long numberOfOverlays = G4Poisson(fSimulationManager->GetOverlayMeanNumberOfEvents());
+    if (numberOfOverlays <= 0) {
+        return;
+    }
+
+    int trackIDOffset = 0;
+    for (const auto& track : fEvent->fTracks) {
+        trackIDOffset = max(trackIDOffset, track.GetTrackID());
+    }
+
+    for (long overlay = 0; overlay < numberOfOverlays; overlay++) {
+        const auto& libraryEvent = library[size_t(G4UniformRand() * library.size()) % library.size()];
+
+        // library events are placed uniformly in a window centered on the simulated event
+        const double timeOffset = (G4UniformRand() - 0.5) * timeWindow;
+        const TVector3 translation = {(G4UniformRand() - 0.5) * translationBox.X(),
+                                      (G4UniformRand() - 0.5) * translationBox.Y(),
+                                      (G4UniformRand() - 0.5) * translationBox.Z()};
+
+        int maxTrackID = 0;
+        for (const auto& libraryTrack : libraryEvent.fTracks) {
+            fEvent->fTracks.push_back(libraryTrack);
+            auto& track = fEvent->fTracks.back();
+
+            // track IDs are shifted so they do not collide with the ones already in the event
+            maxTrackID = max(maxTrackID, track.fTrackID);
+            track.fTrackID += trackIDOffset;
+            if (track.fParentID > 0) {
+                track.fParentID += trackIDOffset;
+            }
+            for (auto& secondaryTrackID : track.fSecondaryTrackIDs) {
+                secondaryTrackID += trackIDOffset;
+            }
+            track.fGlobalTimestamp += timeOffset;
+            track.fInitialPosition += translation;
+
+            auto& hits = track.fHits;
+            // the library may store more columns than requested, use the placeholders of simulated tracks
+            if (!(fContext->fHitFields & HitFields::KineticEnergy)) {
+                hits.fKineticEnergy.assign(hits.GetNumberOfHits(), HitFields::UnsetKineticEnergy);
+            }
+            if (!(fContext->fHitFields & HitFields::MomentumDirection)) {
+                hits.fMomentumDirection.assign(hits.GetNumberOfHits(), TVector3(0, 0, 0));
+            }
+            for (int i = 0; i < int(hits.GetNumberOfHits()); i++) {
+                hits.Translate(i, translation.X(), translation.Y(), translation.Z());
+                hits.fT[i] += timeOffset;
+                if (fVoxelizer && hits.GetEnergy(i) > 0) {
+                    fVoxelizer->Fill({hits.GetX(i), hits.GetY(i), hits.GetZ(i)}, hits.GetEnergy(i));
+                }
+            }
+            if (fVoxelizer) {
+                // same as for simulated tracks, energy is only stored in the voxels
+                hits = TRestGeant4Hits();
+            }
+            hits.SetEvent(fEvent.get());
+            track.SetEvent(fEvent.get());
+
+            fEvent->fTrackIDToTrackIndex[track.fTrackID] = int(fEvent->fTracks.size()) - 1;
+        }
+        trackIDOffset += maxTrackID;
+
+        AddEventEnergies(libraryEvent);
+    }
+}
+
+void OutputManager::SubmitTimeWindowEvents() {
+    if (fPendingSubEvents.empty()) {
+        return;
+    }
+    fEvent.reset();  // empty event prepared after the last sub-event
+    const double window = fSimulationManager->GetEventBuildingWindow();
+    const double deadTime = fSimulationManager->GetEventBuildingDeadTime();
+
+    // time of the first energy deposit (us), or of the first track for sub-events without deposits
+    const auto getStartTime = [](const TRestGeant4Event& subEvent) {
+        Double_t startTime = numeric_limits<Double_t>::max();
+        Double_t firstTrackTime = numeric_limits<Double_t>::max();
+        for (const auto& track : subEvent.fTracks) {
+            firstTrackTime = min(firstTrackTime, track.fGlobalTimestamp);
+            const auto& hits = track.fHits;
+            for (int i = 0; i < int(hits.GetNumberOfHits()); i++) {
+                if (hits.GetEnergy(i) > 0) {
+                    startTime = min(startTime, hits.GetTime(i));
+                }
+            }
+        }
+        return startTime != numeric_limits<Double_t>::max() ? startTime : firstTrackTime;
+    };
+
+    vector<pair<Double_t, unique_ptr<TRestGeant4Event> > > subEvents;
+    subEvents.reserve(fPendingSubEvents.size());
+    for (auto& subEvent : fPendingSubEvents) {
+        const Double_t startTime = getStartTime(*subEvent);
+        subEvents.emplace_back(startTime, std::move(subEvent));
+    }
+    fPendingSubEvents.clear();
+    stable_sort(subEvents.begin(), subEvents.end(),
+                [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    // only sub-events with energy in the sensitive volume trigger, open a window and start the dead time.
+    // Sub-events outside of any window go alone
+    Int_t builtSubEventID = 0;
+    Double_t windowEnd = numeric_limits<Double_t>::lowest();
+    Double_t deadTimeEnd = numeric_limits<Double_t>::lowest();
+    for (auto& [startTime, subEvent] : subEvents) {
+        if (fEvent != nullptr && startTime < windowEnd) {
+            MergeSubEvent(*subEvent);
+            continue;
+        }
+        if (fEvent != nullptr) {
+            SubmitEvent();
+            fEvent.reset();
+        }
+
+        const bool triggers = subEvent->GetSensitiveVolumeEnergy() > 0;
+        if (triggers && startTime < deadTimeEnd) {
+            fNumberOfDeadTimeLosses++;
+            continue;
+        }
+        fEvent = std::move(subEvent);
+        fEvent->SetSubID(builtSubEventID++);
+        windowEnd = numeric_limits<Double_t>::lowest();
+        if (triggers) {
+            fNumberOfTriggers++;
+            windowEnd = startTime + window;
+            deadTimeEnd = startTime + deadTime;
+        }
+    }
+    if (fEvent != nullptr) {
+        SubmitEvent();
+    }
+    UpdateEvent();
+}
+
+void OutputManager::MergeSubEvent(TRestGeant4Event& subEvent) {
+    // track IDs are unique across the sub-events of a Geant4 event, no need to shift them
+    fEvent->fTracks.reserve(fEvent->fTracks.size() + subEvent.fTracks.size());
+    for (auto& subEventTrack : subEvent.fTracks) {
+        fEvent->fTracks.push_back(std::move(subEventTrack));
+        auto& track = fEvent->fTracks.back();
+        track.fHits.SetEvent(fEvent.get());
+        track.SetEvent(fEvent.get());
+        fEvent->fTrackIDToTrackIndex[track.fTrackID] = int(fEvent->fTracks.size()) - 1;
+    }
+    AddEventEnergies(subEvent);
+}
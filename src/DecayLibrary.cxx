@@ -0,0 +1,137 @@
+
+#include "DecayLibrary.h"
+
+#include <CLHEP/Random/MixMaxRng.h>
+#include <G4DynamicParticle.hh>
+#include <G4GenericIon.hh>
+#include <G4Navigator.hh>
+#include <G4ProcessManager.hh>
+#include <G4RadioactiveDecay.hh>
+#include <G4Step.hh>
+#include <G4SystemOfUnits.hh>
+#include <G4TouchableHistory.hh>
+#include <G4Track.hh>
+#include <G4TransportationManager.hh>
+#include <G4VParticleChange.hh>
+#include <Randomize.hh>
+#include <iostream>
+
+using namespace std;
+
+DecayLibrary::DecayLibrary(size_t size, long seed) : fSize(size), fSeed(seed) {
+    if (fSize == 0) {
+        cerr << "DecayLibrary - size must be positive" << endl;
+        exit(1);
+    }
+}
+
+const DecayFinalState* DecayLibrary::Sample(G4ParticleDefinition* nucleus) {
+    auto it = fFinalStates.find(nucleus);
+    const auto& finalStates = it != fFinalStates.end() ? it->second : Tabulate(nucleus);
+    if (finalStates.empty()) {
+        return nullptr;
+    }
+    return &finalStates[size_t(G4UniformRand() * finalStates.size()) % finalStates.size()];
+}
+
+const vector<DecayFinalState>& DecayLibrary::Tabulate(G4ParticleDefinition* nucleus) {
+    auto& finalStates = fFinalStates[nucleus];
+
+    if (fRadioactiveDecay == nullptr) {
+        // all ions share the process manager of the generic ion
+        const auto processList = G4GenericIon::GenericIon()->GetProcessManager()->GetProcessList();
+        for (size_t i = 0; i < processList->size(); i++) {
+            fRadioactiveDecay = dynamic_cast<G4RadioactiveDecay*>((*processList)[i]);
+            if (fRadioactiveDecay != nullptr) {
+                break;
+            }
+        }
+        if (fRadioactiveDecay == nullptr) {
+            cerr << "DecayLibrary - 'G4RadioactiveDecay' process not found, it is required to use the decay "
+                    "library"
+                 << endl;
+            exit(1);
+        }
+    }
+
+    if (nucleus->GetParticleType() != "nucleus" || nucleus->GetPDGStable() ||
+        !fRadioactiveDecay->IsApplicable(*nucleus)) {
+        return finalStates;
+    }
+
+    // the track is not stopped, so the process does not sample the decay time and the products are at the
+    // time of the track. It is located at the origin of the world so that the process sees a valid volume,
+    // touchable and step points, as for a tracked nucleus
+    G4Track track(new G4DynamicParticle(nucleus, G4ThreeVector(0, 0, 1), 0), 0, G4ThreeVector());
+    G4Navigator navigator;
+    navigator.SetWorldVolume(
+        G4TransportationManager::GetTransportationManager()->GetNavigatorForTracking()->GetWorldVolume());
+    navigator.LocateGlobalPointAndSetup(track.GetPosition(), nullptr, false, true);
+    const G4TouchableHandle touchable(navigator.CreateTouchableHistory());
+    track.SetTouchableHandle(touchable);
+    track.SetNextTouchableHandle(touchable);
+    G4Step step;
+    step.InitializeStep(&track);
+    track.SetStep(&step);
+
+    // the library only depends on the run seed and the isotope, not on the thread or on the events already
+    // processed by it
+    CLHEP::HepRandomEngine* eventsEngine = G4Random::getTheEngine();
+    CLHEP::MixMaxRng engine;
+    engine.setSeed(fSeed ^ (long(nucleus->GetPDGEncoding()) << 16), 0);
+    G4Random::setTheEngine(&engine);
+
+    finalStates.reserve(fSize);
+    size_t lostLocalEnergyDeposits = 0;
+    for (size_t n = 0; n < fSize; n++) {
+        auto particleChange = fRadioactiveDecay->AtRestDoIt(track, step);
+
+        DecayFinalState finalState;
+        finalState.reserve(particleChange->GetNumberOfSecondaries());
+        DecayProduct* recoil = nullptr;
+        for (int i = 0; i < particleChange->GetNumberOfSecondaries(); i++) {
+            const G4Track* secondary = particleChange->GetSecondary(i);
+            finalState.push_back({secondary->GetDefinition(), secondary->GetMomentumDirection(),
+                                  secondary->GetKineticEnergy(),
+                                  secondary->GetGlobalTime() - track.GetGlobalTime()});
+            if (secondary->GetDefinition()->GetParticleType() == "nucleus") {
+                recoil = &finalState.back();  // no reallocation, capacity was reserved
+            }
+            delete secondary;
+        }
+        // energy deposited locally by the process (e.g. atomic relaxation without particles) goes to the
+        // recoiling nucleus, whose range is far below any detector resolution
+        const G4double localEnergyDeposit = particleChange->GetLocalEnergyDeposit();
+        if (localEnergyDeposit > 0) {
+            if (recoil != nullptr) {
+                recoil->fEnergy += localEnergyDeposit;
+            } else {
+                lostLocalEnergyDeposits++;
+            }
+        }
+        particleChange->Clear();
+
+        if (!finalState.empty()) {
+            finalStates.push_back(move(finalState));
+        }
+    }
+    G4Random::setTheEngine(eventsEngine);
+
+    if (lostLocalEnergyDeposits > 0) {
+        G4cout << "DecayLibrary - " << lostLocalEnergyDeposits << " decays of '" << nucleus->GetParticleName()
+               << "' deposited energy locally without a recoiling nucleus to carry it, it is not simulated"
+               << G4endl;
+    }
+
+    if (finalStates.empty()) {
+        // e.g. lifetime above the threshold of the process, it will be generated as a regular primary
+        G4cout << "DecayLibrary - '" << nucleus->GetParticleName()
+               << "' did not produce any decay products, it will not be sampled from the decay library"
+               << G4endl;
+    } else {
+        G4cout << "DecayLibrary - Tabulated " << finalStates.size() << " decays of '"
+               << nucleus->GetParticleName() << "'" << G4endl;
+    }
+
+    return finalStates;
+}
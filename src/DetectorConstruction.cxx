@@ -10,6 +10,7 @@
 #include <G4LogicalVolumeStore.hh>
 #include <G4MagneticField.hh>
 #include <G4Material.hh>
+#include <G4RegionStore.hh>
 #include <G4RunManager.hh>
 #include <G4SDManager.hh>
 #include <G4SystemOfUnits.hh>
@@ -17,6 +18,7 @@
 #include <G4UserLimits.hh>
 #include <filesystem>
 
+#include "FastEnergyDepositModel.h"
 #include "SimulationManager.h"
 
 using namespace std;
@@ -52,6 +54,10 @@ G4VPhysicalVolume* DetectorConstruction::Construct() {
     fGdmlParser->Read(gdmlToRead, false);
     G4VPhysicalVolume* worldVolume = fGdmlParser->GetWorldVolume();
 
+    fSimulationManager->SetGeometryIndex(make_unique<const GeometryIndex>(worldVolume));
+    cout << "Geometry index contains " << fSimulationManager->GetGeometryIndex()->GetNumberOfVolumes()
+         << " volume placements" << endl;
+
     restG4Metadata->fGeant4GeometryInfo.InitializeOnDetectorConstruction(gdmlToRead, worldVolume);
     restG4Metadata->ReadDetector();
     restG4Metadata->PrintMetadata();  // now we have detector info
@@ -182,6 +188,17 @@ G4VPhysicalVolume* DetectorConstruction::Construct() {
         }
     }
 
+    auto importanceMap = fSimulationManager->GetImportanceMap();
+    if (importanceMap != nullptr && !importanceMap->HasBounds()) {
+        importanceMap->SetBoundsFromWorld(worldVolume);
+        cout << "Importance map mesh: " << importanceMap->ToString() << endl;
+    }
+
+    // regions are shared, the fast simulation models are created per thread in 'ConstructSDandField'
+    for (const auto& regionName : fSimulationManager->GetFastSimulationRegions()) {
+        FindOrCreateRegion(regionName);
+    }
+
     return worldVolume;
 }
 
@@ -202,6 +219,35 @@ G4VPhysicalVolume* DetectorConstruction::GetPhysicalVolume(const G4String& physV
     return nullptr;
 }
 
+G4Region* DetectorConstruction::FindOrCreateRegion(const G4String& name) {
+    G4Region* region = G4RegionStore::GetInstance()->GetRegion(name, false);
+    if (region != nullptr) {
+        return region;
+    }
+
+    auto logicalVolume = G4LogicalVolumeStore::GetInstance()->GetVolume(name, false);
+    if (logicalVolume == nullptr) {
+        const auto physicalVolume = G4PhysicalVolumeStore::GetInstance()->GetVolume(name, false);
+        if (physicalVolume != nullptr) {
+            logicalVolume = physicalVolume->GetLogicalVolume();
+        }
+    }
+    if (logicalVolume == nullptr) {
+        cerr << "DetectorConstruction::FindOrCreateRegion - Region or volume '" << name << "' not found"
+             << endl;
+        exit(1);
+    }
+    if (logicalVolume->GetRegion() != nullptr && logicalVolume->IsRootRegion()) {
+        cerr << "DetectorConstruction::FindOrCreateRegion - Volume '" << name
+             << "' already is the root of region '" << logicalVolume->GetRegion()->GetName()
+             << "', use the region name instead" << endl;
+        exit(1);
+    }
+    region = new G4Region(name);
+    region->AddRootLogicalVolume(logicalVolume);
+    return region;
+}
+
 void DetectorConstruction::ConstructSDandField() {
     const TRestGeant4Metadata& metadata = *fSimulationManager->GetRestMetadata();
 
@@ -253,35 +299,57 @@ void DetectorConstruction::ConstructSDandField() {
         auto region = new G4Region(name);
         logicalVolume->SetRegion(region);
     }
+
+    for (const auto& regionName : fSimulationManager->GetFastSimulationRegions()) {
+        new FastEnergyDepositModel("FastEnergyDeposit_" + regionName, FindOrCreateRegion(regionName),
+                                   fSimulationManager->GetFastSimulationEnergyThreshold() * keV,
+                                   fSimulationManager->GetFastSimulationGammaEnergyThreshold() * keV);
+    }
 }
 
 void TRestGeant4GeometryInfo::PopulateFromGeant4World(const G4VPhysicalVolume* world) {
     auto detector = (DetectorConstruction*)G4RunManager::GetRunManager()->GetUserDetectorConstruction();
     TRestGeant4Metadata* restG4Metadata = detector->fSimulationManager->GetRestMetadata();
+    const GeometryIndex* geometryIndex = detector->fSimulationManager->GetGeometryIndex();
 
+    // daughters of the world first and then the world, keeping the IDs of previous versions. Deeper volumes
+    // follow in depth first order, each physical volume name only once
+    vector<const G4VPhysicalVolume*> volumes;
     const size_t n = int(world->GetLogicalVolume()->GetNoDaughters());
-    for (size_t i = 0; i < n + 1; i++) {  // world is the + 1
-        G4VPhysicalVolume* volume;
-        if (i == n) {
-            volume = const_cast<G4VPhysicalVolume*>(world);
-        } else {
-            volume = world->GetLogicalVolume()->GetDaughter(i);
+    for (size_t i = 0; i < n; i++) {
+        volumes.push_back(world->GetLogicalVolume()->GetDaughter(i));
+    }
+    volumes.push_back(world);
+    map<const G4VPhysicalVolume*, G4ThreeVector> positionsInWorld;
+    for (const auto& indexVolume : geometryIndex->GetVolumes()) {
+        positionsInWorld.emplace(indexVolume.fPhysicalVolume, indexVolume.fGlobalTransform.NetTranslation());
+        if (indexVolume.fDepth > 1) {
+            volumes.push_back(indexVolume.fPhysicalVolume);
         }
+    }
+
+    Int_t id = 0;
+    for (size_t i = 0; i < volumes.size(); i++) {
+        const G4VPhysicalVolume* volume = volumes[i];
         TString namePhysical = (TString)volume->GetName();
-        if (fGdmlNewPhysicalNames.size() > i) {
+        if (i < n && fGdmlNewPhysicalNames.size() > i) {
             // it has been filled
             fGeant4PhysicalNameToNewPhysicalNameMap[namePhysical] = fGdmlNewPhysicalNames[i];
         }
         TString physicalNewName = GetAlternativeNameFromGeant4PhysicalName(namePhysical);
+        if (i > n && fPhysicalToLogicalVolumeMap.count(physicalNewName) > 0) {
+            continue;  // placed more than once
+        }
         TString nameLogical = (TString)volume->GetLogicalVolume()->GetName();
         TString nameMaterial = (TString)volume->GetLogicalVolume()->GetMaterial()->GetName();
-        auto position = volume->GetTranslation();
+        // first placement for volumes placed more than once
+        const auto& position = positionsInWorld.at(volume);
 
         fPhysicalToLogicalVolumeMap[physicalNewName] = nameLogical;
         fLogicalToMaterialMap[nameLogical] = nameMaterial;
         fLogicalToPhysicalMap[nameLogical].emplace_back(namePhysical);
         fPhysicalToPositionInWorldMap[physicalNewName] = {position.x(), position.y(), position.z()};
-        InsertVolumeName(i, physicalNewName);
+        InsertVolumeName(id++, physicalNewName);
 
         if (!fIsAssembly && GetAlternativeNameFromGeant4PhysicalName(namePhysical) != namePhysical) {
             fIsAssembly = true;
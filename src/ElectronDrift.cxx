@@ -0,0 +1,189 @@
+
+#include "ElectronDrift.h"
+
+#include <TRestGeant4GeometryInfo.h>
+#include <TRestGeant4Track.h>
+#include <TString.h>
+
+#include <CLHEP/Random/RandBinomial.h>
+#include <Randomize.hh>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+
+ElectronDrift::ElectronDrift(const Parameters& parameters) : fParameters(parameters) {
+    if (fParameters.fDriftVelocity <= 0 || fParameters.fWValue <= 0 || fParameters.fPitch <= 0 ||
+        fParameters.fSamplingTime <= 0) {
+        cerr << "ElectronDrift - drift velocity, W-value, readout pitch and sampling time must be positive"
+             << endl;
+        exit(1);
+    }
+    if (fParameters.fPlaneNormal.Mag() == 0) {
+        cerr << "ElectronDrift - readout plane normal cannot be null" << endl;
+        exit(1);
+    }
+    fParameters.fPlaneNormal = fParameters.fPlaneNormal.Unit();
+    fPlaneU = fParameters.fPlaneNormal.Orthogonal().Unit();
+    fPlaneV = fParameters.fPlaneNormal.Cross(fPlaneU);
+}
+
+ReadoutSignalEvent ElectronDrift::Process(Int_t eventID, Int_t subEventID,
+                                          const vector<TRestGeant4Track>& tracks,
+                                          const TRestGeant4GeometryInfo& geometryInfo) {
+    if (fVolumeID < 0) {
+        // same name conversion as the volumes of the hits, needed for assemblies and renamed volumes
+        fVolumeID = geometryInfo.GetIDFromVolume(
+            geometryInfo.GetAlternativeNameFromGeant4PhysicalName(fParameters.fVolume.c_str()));
+        if (fVolumeID < 0) {
+            cerr << "ElectronDrift - drift volume '" << fParameters.fVolume << "' not found in the geometry"
+                 << endl;
+            exit(1);
+        }
+    }
+
+    fSignals.clear();
+
+    for (const auto& track : tracks) {
+        const auto& hits = track.GetHits();
+        for (int i = 0; i < int(hits.GetNumberOfHits()); i++) {
+            const auto energy = hits.GetEnergy(i);
+            if (energy <= 0 || hits.GetVolumeId(i) != fVolumeID) {
+                continue;
+            }
+
+            const TVector3 relativePosition = TVector3(hits.GetX(i), hits.GetY(i), hits.GetZ(i)) -
+                                              fParameters.fPlanePosition;
+            const Double_t distance = relativePosition.Dot(fParameters.fPlaneNormal);  // mm
+            if (distance < 0) {
+                continue;  // behind the readout plane
+            }
+            const Double_t distanceCm = distance / 10;
+
+            // Poisson thinning: surviving electrons are still Poisson distributed
+            const Double_t meanElectrons = energy * 1000 / fParameters.fWValue *
+                                           exp(-fParameters.fAttachment * distanceCm);
+            const long numberOfElectrons = G4Poisson(meanElectrons);
+            if (numberOfElectrons <= 0) {
+                continue;
+            }
+
+            const Double_t sigmaTransverse = 10 * fParameters.fTransverseDiffusion * sqrt(distanceCm);
+            const Double_t sigmaLongitudinal = 10 * fParameters.fLongitudinalDiffusion * sqrt(distanceCm);
+            const Double_t u = relativePosition.Dot(fPlaneU);
+            const Double_t v = relativePosition.Dot(fPlaneV);
+            const Double_t arrivalTime = hits.GetTime(i) + distance / fParameters.fDriftVelocity;
+            const Double_t sigmaTime = sigmaLongitudinal / fParameters.fDriftVelocity;
+
+            Int_t firstU, firstV, firstTime;
+            BinProbabilities(u, sigmaTransverse, fParameters.fPitch, firstU, fProbabilitiesU);
+            BinProbabilities(v, sigmaTransverse, fParameters.fPitch, firstV, fProbabilitiesV);
+            BinProbabilities(arrivalTime, sigmaTime, fParameters.fSamplingTime, firstTime,
+                             fProbabilitiesTime);
+            const size_t numberOfCells =
+                fProbabilitiesU.size() * fProbabilitiesV.size() * fProbabilitiesTime.size();
+
+            if (size_t(numberOfElectrons) < numberOfCells) {
+                // few electrons spread over many channels, cheaper to sample each of them
+                for (long electron = 0; electron < numberOfElectrons; electron++) {
+                    const Double_t uReadout = G4RandGauss::shoot(u, sigmaTransverse);
+                    const Double_t vReadout = G4RandGauss::shoot(v, sigmaTransverse);
+                    const Double_t timeReadout = G4RandGauss::shoot(arrivalTime, sigmaTime);
+                    fSignals[make_tuple(Int_t(floor(uReadout / fParameters.fPitch)),
+                                        Int_t(floor(vReadout / fParameters.fPitch)),
+                                        Int_t(floor(timeReadout / fParameters.fSamplingTime)))]++;
+                }
+                continue;
+            }
+
+            // multinomial sampling of the number of electrons of each channel and time bin, as a chain of
+            // binomials over the cells covered by the diffusion of the hit
+            long remainingElectrons = numberOfElectrons;
+            Double_t remainingProbability = 1;
+            for (size_t iTime = 0; iTime < fProbabilitiesTime.size() && remainingElectrons > 0; iTime++) {
+                for (size_t iV = 0; iV < fProbabilitiesV.size() && remainingElectrons > 0; iV++) {
+                    for (size_t iU = 0; iU < fProbabilitiesU.size() && remainingElectrons > 0; iU++) {
+                        const Double_t probability =
+                            fProbabilitiesU[iU] * fProbabilitiesV[iV] * fProbabilitiesTime[iTime];
+                        const long electrons =
+                            probability >= remainingProbability
+                                ? remainingElectrons
+                                : long(CLHEP::RandBinomial::shoot(remainingElectrons,
+                                                                  probability / remainingProbability));
+                        remainingProbability -= probability;
+                        if (electrons <= 0) {
+                            continue;
+                        }
+                        remainingElectrons -= electrons;
+                        const auto key =
+                            make_tuple(firstU + Int_t(iU), firstV + Int_t(iV), firstTime + Int_t(iTime));
+                        fSignals[key] += Int_t(electrons);
+                    }
+                }
+            }
+        }
+    }
+
+    // channels in a fixed order, independent of the hash table
+    vector<const pair<const tuple<Int_t, Int_t, Int_t>, Int_t>*> signals;
+    signals.reserve(fSignals.size());
+    for (const auto& signal : fSignals) {
+        signals.push_back(&signal);
+    }
+    sort(signals.begin(), signals.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+    ReadoutSignalEvent signalEvent;
+    signalEvent.fEventID = eventID;
+    signalEvent.fSubEventID = subEventID;
+
+    signalEvent.fChannelX.reserve(fSignals.size());
+    signalEvent.fChannelY.reserve(fSignals.size());
+    signalEvent.fTimeBin.reserve(fSignals.size());
+    signalEvent.fCharge.reserve(fSignals.size());
+
+    for (const auto signal : signals) {
+        signalEvent.fChannelX.push_back(get<0>(signal->first));
+        signalEvent.fChannelY.push_back(get<1>(signal->first));
+        signalEvent.fTimeBin.push_back(get<2>(signal->first));
+        signalEvent.fCharge.push_back(signal->second);
+    }
+
+    return signalEvent;
+}
+
+void ElectronDrift::BinProbabilities(Double_t mean, Double_t sigma, Double_t width, Int_t& firstBin,
+                                     vector<Double_t>& probabilities) {
+    probabilities.clear();
+    if (sigma <= 0) {
+        firstBin = Int_t(floor(mean / width));
+        probabilities.push_back(1);
+        return;
+    }
+    // tails beyond 4 sigma are neglected, the probabilities are normalized to the covered range
+    firstBin = Int_t(floor((mean - 4 * sigma) / width));
+    const Int_t lastBin = Int_t(floor((mean + 4 * sigma) / width));
+    Double_t total = 0;
+    for (Int_t bin = firstBin; bin <= lastBin; bin++) {
+        const Double_t probability = 0.5 * (erf(((bin + 1) * width - mean) / (sqrt(2) * sigma)) -
+                                            erf((bin * width - mean) / (sqrt(2) * sigma)));
+        probabilities.push_back(probability);
+        total += probability;
+    }
+    for (auto& probability : probabilities) {
+        probability /= total;
+    }
+}
+
+string ElectronDrift::ToString() const {
+    const auto& p = fParameters;
+    return TString::Format(
+               "driftVolume=%s readoutPlanePosition=(%g,%g,%g)mm readoutPlaneNormal=(%g,%g,%g) "
+               "driftVelocity=%gmm/us longitudinalDiffusion=%gsqrt(cm) transverseDiffusion=%gsqrt(cm) "
+               "attachment=%g/cm wValue=%geV readoutPitch=%gmm samplingTime=%gus",
+               p.fVolume.c_str(), p.fPlanePosition.X(), p.fPlanePosition.Y(), p.fPlanePosition.Z(),
+               p.fPlaneNormal.X(), p.fPlaneNormal.Y(), p.fPlaneNormal.Z(), p.fDriftVelocity,
+               p.fLongitudinalDiffusion, p.fTransverseDiffusion, p.fAttachment, p.fWValue, p.fPitch,
+               p.fSamplingTime)
+        .Data();
+}
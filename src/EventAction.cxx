@@ -54,5 +54,9 @@ void EventAction::BeginOfEventAction(const G4Event* event) {
 }
 
 void EventAction::EndOfEventAction(const G4Event*) {
-    fSimulationManager->GetOutputManager()->FinishAndSubmitEvent();
+    const auto outputManager = fSimulationManager->GetOutputManager();
+    outputManager->FinishAndSubmitEvent();
+    if (fSimulationManager->GetEventBuildingWindow() > 0) {
+        outputManager->SubmitTimeWindowEvents();
+    }
 }
@@ -0,0 +1,98 @@
+
+#include "EventCompression.h"
+
+#include <RZip.h>
+#include <TBufferFile.h>
+#include <TRestGeant4Event.h>
+
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+// maximum size of a single compression block, same as used by TBasket
+constexpr int maxBlockSize = 0xffffff;
+// each compressed block carries a 9 byte header
+constexpr int blockHeaderSize = 9;
+}  // namespace
+
+CompressedEvent EventCompression::Compress(const TRestGeant4Event& event, int compressionSettings) {
+    TBufferFile buffer(TBuffer::kWrite);
+    buffer.WriteObjectAny(&event, TRestGeant4Event::Class());
+
+    CompressedEvent compressedEvent;
+    compressedEvent.fEventID = event.GetID();
+    compressedEvent.fSubEventID = event.GetSubID();
+    compressedEvent.fUncompressedSize = buffer.Length();
+
+    const int level = compressionSettings % 100;
+    const auto algorithm = ROOT::RCompressionSetting::EAlgorithm::EValues(compressionSettings / 100);
+
+    char* source = buffer.Buffer();
+    const int sourceSize = buffer.Length();
+
+    if (level > 0) {
+        const int numberOfBlocks = (sourceSize + maxBlockSize - 1) / maxBlockSize;
+        compressedEvent.fBuffer.resize(sourceSize + numberOfBlocks * blockHeaderSize);
+
+        int compressedSize = 0;
+        bool compressed = true;
+        for (int offset = 0; offset < sourceSize; offset += maxBlockSize) {
+            int blockSize = min(maxBlockSize, sourceSize - offset);
+            int targetSize = int(compressedEvent.fBuffer.size()) - compressedSize;
+            int written = 0;
+            R__zipMultipleAlgorithm(level, &blockSize, source + offset, &targetSize,
+                                    compressedEvent.fBuffer.data() + compressedSize, &written, algorithm);
+            if (written == 0) {
+                compressed = false;  // not compressible, same fallback as TBasket
+                break;
+            }
+            compressedSize += written;
+        }
+        if (compressed && compressedSize < sourceSize) {
+            compressedEvent.fBuffer.resize(compressedSize);
+            return compressedEvent;
+        }
+    }
+
+    compressedEvent.fBuffer.assign(source, source + sourceSize);
+    return compressedEvent;
+}
+
+unique_ptr<TRestGeant4Event> EventCompression::Decompress(const CompressedEvent& compressedEvent) {
+    vector<char> uncompressed;
+    const vector<char>* streamed = &compressedEvent.fBuffer;
+
+    if (int(compressedEvent.fBuffer.size()) != compressedEvent.fUncompressedSize) {
+        uncompressed.resize(compressedEvent.fUncompressedSize);
+
+        auto source = (unsigned char*)compressedEvent.fBuffer.data();
+        const int sourceSize = compressedEvent.fBuffer.size();
+        int sourceOffset = 0;
+        int targetOffset = 0;
+        while (sourceOffset < sourceSize && targetOffset < compressedEvent.fUncompressedSize) {
+            int blockSize = 0;
+            int blockTargetSize = 0;
+            if (R__unzip_header(&blockSize, source + sourceOffset, &blockTargetSize) != 0) {
+                cerr << "EventCompression - Corrupted buffer for event " << compressedEvent.fEventID << endl;
+                return nullptr;
+            }
+            int targetSize = compressedEvent.fUncompressedSize - targetOffset;
+            int written = 0;
+            R__unzip(&blockSize, source + sourceOffset, &targetSize,
+                     (unsigned char*)uncompressed.data() + targetOffset, &written);
+            if (written != blockTargetSize) {
+                cerr << "EventCompression - Unable to decompress event " << compressedEvent.fEventID << endl;
+                return nullptr;
+            }
+            sourceOffset += blockSize;
+            targetOffset += written;
+        }
+        streamed = &uncompressed;
+    }
+
+    TBufferFile buffer(TBuffer::kRead, int(streamed->size()), const_cast<char*>(streamed->data()), false);
+    return unique_ptr<TRestGeant4Event>(
+        static_cast<TRestGeant4Event*>(buffer.ReadObjectAny(TRestGeant4Event::Class())));
+}
@@ -0,0 +1,74 @@
+
+#include "FastEnergyDepositModel.h"
+
+#include <G4DynamicParticle.hh>
+#include <G4Electron.hh>
+#include <G4FastStep.hh>
+#include <G4FastTrack.hh>
+#include <G4Gamma.hh>
+#include <G4LossTableManager.hh>
+#include <G4PhysicalConstants.hh>
+#include <G4Positron.hh>
+#include <G4RandomDirection.hh>
+#include <G4VSolid.hh>
+
+using namespace std;
+
+FastEnergyDepositModel::FastEnergyDepositModel(const G4String& name, G4Region* region,
+                                               G4double energyThreshold, G4double gammaEnergyThreshold)
+    : G4VFastSimulationModel(name, region),
+      fEnergyThreshold(energyThreshold),
+      fGammaEnergyThreshold(gammaEnergyThreshold) {}
+
+G4bool FastEnergyDepositModel::IsApplicable(const G4ParticleDefinition& particle) {
+    return &particle == G4Electron::Definition() || &particle == G4Positron::Definition() ||
+           (&particle == G4Gamma::Definition() && fGammaEnergyThreshold > 0);
+}
+
+G4double FastEnergyDepositModel::GetGammaAttenuationLength(const G4FastTrack& fastTrack) {
+    const G4Track* track = fastTrack.GetPrimaryTrack();
+    const G4double energy = track->GetKineticEnergy();
+    const G4Material* material = track->GetMaterial();
+    // from the tables of the physics list, processes that are not registered do not contribute
+    G4double crossSection = 0;
+    for (const char* process : {"phot", "compt", "conv", "Rayl"}) {
+        crossSection +=
+            fEmCalculator.GetCrossSectionPerVolume(energy, G4Gamma::Definition(), process, material);
+    }
+    return crossSection > 0 ? 1 / crossSection : kInfinity;
+}
+
+G4bool FastEnergyDepositModel::ModelTrigger(const G4FastTrack& fastTrack) {
+    const G4Track* track = fastTrack.GetPrimaryTrack();
+    const G4double energy = track->GetKineticEnergy();
+    const bool isGamma = track->GetDefinition() == G4Gamma::Definition();
+    if (energy >= (isGamma ? fGammaEnergyThreshold : fEnergyThreshold)) {
+        return false;
+    }
+    const G4double distanceToOut =
+        fastTrack.GetEnvelopeSolid()->DistanceToOut(fastTrack.GetPrimaryTrackLocalPosition());
+    if (isGamma) {
+        const G4double attenuationLength = GetGammaAttenuationLength(fastTrack);
+        return attenuationLength < distanceToOut / fGammaAttenuationLengths;
+    }
+    const G4double range = G4LossTableManager::Instance()->GetRange(track->GetDefinition(), energy,
+                                                                    track->GetMaterialCutsCouple());
+    return range < distanceToOut;
+}
+
+void FastEnergyDepositModel::DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep) {
+    const G4Track* track = fastTrack.GetPrimaryTrack();
+    if (track->GetDefinition() == G4Positron::Definition()) {
+        // annihilation at rest, the photons can escape so they are tracked
+        const G4ThreeVector direction = G4RandomDirection();
+        fastStep.SetNumberOfSecondaryTracks(2);
+        for (const auto& photonDirection : {direction, -direction}) {
+            fastStep.CreateSecondaryTrack(G4DynamicParticle(G4Gamma::Definition(), photonDirection,
+                                                            electron_mass_c2),
+                                          track->GetPosition(), track->GetGlobalTime(), false);
+        }
+    }
+    fastStep.KillPrimaryTrack();
+    fastStep.ProposePrimaryTrackPathLength(0);
+    fastStep.ProposeTotalEnergyDeposited(track->GetKineticEnergy());
+}
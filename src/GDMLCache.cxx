@@ -0,0 +1,182 @@
+
+#include "GDMLCache.h"
+
+#include <TArrayI.h>
+#include <TMD5.h>
+#include <TPRegexp.h>
+#include <TString.h>
+#include <TUUID.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+namespace {
+constexpr const char* cachedGdmlName = "geometry.gdml";
+constexpr const char* cachedVersionsName = "versions.txt";
+
+bool IsRemote(const string& filename) { return filename.rfind("http", 0) == 0; }
+
+string ReadFile(const string& filename) {
+    ifstream file(filename, ios::binary);
+    stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+}  // namespace
+
+GDMLCache::GDMLCache(const string& directory, bool offline) : fDirectory(directory), fOffline(offline) {
+    error_code error;
+    filesystem::create_directories(fDirectory, error);
+    if (!filesystem::is_directory(fDirectory)) {
+        cerr << "GDMLCache - Unable to create cache directory '" << fDirectory << "'" << endl;
+        exit(1);
+    }
+}
+
+string GDMLCache::GetKey(const string& gdmlFilename) {
+    TMD5 md5;
+    const auto addToKey = [&md5](const string& data) {
+        md5.Update(reinterpret_cast<const UChar_t*>(data.data()), data.size());
+    };
+
+    TPRegexp variableRegexp(R"(\$\{(\w+)\})");
+    TPRegexp entityRegexp(R"(<!ENTITY\s+\w+\s+SYSTEM\s+"([^"]+)")");
+
+    // system variables are substituted by the GDML parser, so their values are part of the key. Unset ones
+    // cannot be known here and disable the cache
+    bool unknownVariable = false;
+    const auto addVariablesToKey = [&](const TString& text) {
+        Ssiz_t position = 0;
+        TArrayI match;
+        while (variableRegexp.Match(text, "", position, 10, &match) > 1) {
+            const string variable = text(match[2], match[3] - match[2]).Data();
+            const char* value = getenv(variable.c_str());
+            if (value == nullptr) {
+                cout << "GDMLCache - System variable '" << variable
+                     << "' used by the geometry is not set, the cache is not used" << endl;
+                unknownVariable = true;
+            } else {
+                addToKey(variable + "=" + value);
+            }
+            position = match[1];
+        }
+    };
+    const auto expandVariables = [](string text) {
+        size_t start;
+        while ((start = text.find("${")) != string::npos) {
+            const size_t end = text.find('}', start);
+            if (end == string::npos) {
+                break;
+            }
+            const char* value = getenv(text.substr(start + 2, end - start - 2).c_str());
+            text.replace(start, end - start + 1, value != nullptr ? value : "");
+        }
+        return text;
+    };
+
+    if (IsRemote(gdmlFilename)) {
+        addToKey(gdmlFilename);
+        md5.Final();
+        return md5.AsString();
+    }
+
+    // the GDML file and its local file entities, '<!ENTITY name SYSTEM "file">', at any depth. Entities are
+    // relative to the file declaring them. Remote entities are identified by their URL
+    set<string> visited;
+    vector<filesystem::path> pending = {filesystem::path(gdmlFilename)};
+    while (!pending.empty()) {
+        const auto filename = pending.back();
+        pending.pop_back();
+        if (!visited.insert(filesystem::absolute(filename).lexically_normal().string()).second) {
+            continue;
+        }
+
+        const TString content = ReadFile(filename.string());
+        addToKey(content.Data());
+        addVariablesToKey(content);
+
+        Ssiz_t position = 0;
+        TArrayI match;
+        while (entityRegexp.Match(content, "", position, 10, &match) > 1) {
+            const string entity = expandVariables(content(match[2], match[3] - match[2]).Data());
+            addToKey(entity);
+            if (!IsRemote(entity)) {
+                pending.push_back(filename.parent_path() / entity);
+            }
+            position = match[1];
+        }
+    }
+
+    if (unknownVariable) {
+        return "";
+    }
+    md5.Final();
+    return md5.AsString();
+}
+
+bool GDMLCache::Lookup(const string& gdmlFilename, Entry& entry) const {
+    const auto key = GetKey(gdmlFilename);
+    if (key.empty()) {
+        if (fOffline) {
+            cerr << "GDMLCache - Geometry '" << gdmlFilename << "' cannot be identified in the cache '"
+                 << fDirectory << "' and offline mode is enabled" << endl;
+            exit(1);
+        }
+        return false;
+    }
+    const auto entryPath = filesystem::path(fDirectory) / key;
+
+    ifstream versions(entryPath / cachedVersionsName);
+    if (!versions.is_open() || !filesystem::exists(entryPath / cachedGdmlName)) {
+        if (fOffline) {
+            cerr << "GDMLCache - Geometry '" << gdmlFilename << "' (key " << key << ") is not in the cache '"
+                 << fDirectory << "' and offline mode is enabled" << endl;
+            exit(1);
+        }
+        return false;
+    }
+
+    entry.fGdmlFilename = (entryPath / cachedGdmlName).string();
+    getline(versions, entry.fGdmlVersion);
+    getline(versions, entry.fMaterialsVersion);
+
+    cout << "GDMLCache - Using cached geometry '" << entry.fGdmlFilename << "'" << endl;
+    return true;
+}
+
+void GDMLCache::Store(const string& gdmlFilename, const Entry& entry) const {
+    const auto key = GetKey(gdmlFilename);
+    const auto entryPath = filesystem::path(fDirectory) / key;
+    if (key.empty() || filesystem::exists(entryPath)) {
+        return;
+    }
+
+    // written in a private directory and renamed, jobs starting at the same time may race to store the
+    // same entry and readers must never see a partial one
+    const auto temporaryPath = filesystem::path(fDirectory) / (key + ".tmp." + TUUID().AsString());
+
+    error_code error;
+    filesystem::create_directories(temporaryPath, error);
+    filesystem::copy_file(entry.fGdmlFilename, temporaryPath / cachedGdmlName,
+                          filesystem::copy_options::overwrite_existing, error);
+    if (!error) {
+        ofstream versions(temporaryPath / cachedVersionsName);
+        versions << entry.fGdmlVersion << "\n" << entry.fMaterialsVersion << "\n";
+    }
+    if (!error) {
+        filesystem::rename(temporaryPath, entryPath, error);
+    }
+    if (error) {
+        // another job stored it first, or the cache is not writable. Neither prevents this job from running
+        filesystem::remove_all(temporaryPath, error);
+        return;
+    }
+
+    cout << "GDMLCache - Stored geometry '" << gdmlFilename << "' in cache with key " << key << endl;
+}
@@ -0,0 +1,39 @@
+
+#include "GeometryIndex.h"
+
+#include <G4LogicalVolume.hh>
+#include <G4VPhysicalVolume.hh>
+
+using namespace std;
+
+GeometryIndex::GeometryIndex(const G4VPhysicalVolume* world) { Add(world, -1); }
+
+void GeometryIndex::Add(const G4VPhysicalVolume* physicalVolume, Int_t parent) {
+    // iterative depth first traversal, deep trees would overflow the stack if done recursively
+    vector<pair<const G4VPhysicalVolume*, Int_t> > pending = {{physicalVolume, parent}};
+    while (!pending.empty()) {
+        const auto [current, currentParent] = pending.back();
+        pending.pop_back();
+
+        Volume volume;
+        volume.fPhysicalVolume = current;
+        volume.fCopyNumber = current->IsReplicated() ? -1 : current->GetCopyNo();
+        volume.fParent = currentParent;
+        if (currentParent >= 0) {
+            const auto& parentVolume = fVolumes[currentParent];
+            volume.fDepth = parentVolume.fDepth + 1;
+            // local to mother frame, built from the frame rotation as G4NavigationLevel does
+            volume.fGlobalTransform = G4AffineTransform(current->GetRotation(), current->GetTranslation()) *
+                                      parentVolume.fGlobalTransform;
+        }
+
+        const auto id = Int_t(fVolumes.size());
+        fVolumes.push_back(volume);
+
+        const auto logicalVolume = current->GetLogicalVolume();
+        // reversed so daughters are indexed in placement order
+        for (size_t i = logicalVolume->GetNoDaughters(); i > 0; i--) {
+            pending.emplace_back(logicalVolume->GetDaughter(i - 1), id);
+        }
+    }
+}
@@ -0,0 +1,59 @@
+
+#include "HitVoxelizer.h"
+
+#include <TMath.h>
+#include <TString.h>
+
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+
+HitVoxelizer::HitVoxelizer(const TVector3& voxelSize, const TVector3& origin, const TVector3& rotation)
+    : fVoxelSize(voxelSize), fOrigin(origin), fRotation(rotation) {
+    if (fVoxelSize.X() <= 0 || fVoxelSize.Y() <= 0 || fVoxelSize.Z() <= 0) {
+        cerr << "HitVoxelizer - voxel size must be positive in all dimensions" << endl;
+        exit(1);
+    }
+    // grid frame is rotated around X, then Y, then Z with respect to the world frame
+    TRotation gridRotation;
+    gridRotation.RotateX(fRotation.X() * TMath::DegToRad());
+    gridRotation.RotateY(fRotation.Y() * TMath::DegToRad());
+    gridRotation.RotateZ(fRotation.Z() * TMath::DegToRad());
+    fInverseRotation = gridRotation.Inverse();
+}
+
+void HitVoxelizer::Fill(const TVector3& position, Double_t energy) {
+    const TVector3 local = fInverseRotation * (position - fOrigin);
+    const auto key = make_tuple(Int_t(floor(local.X() / fVoxelSize.X())),  //
+                                Int_t(floor(local.Y() / fVoxelSize.Y())),  //
+                                Int_t(floor(local.Z() / fVoxelSize.Z())));
+    fVoxels[key] += energy;
+}
+
+VoxelEvent HitVoxelizer::GetVoxelEvent(Int_t eventID, Int_t subEventID) const {
+    VoxelEvent voxelEvent;
+    voxelEvent.fEventID = eventID;
+    voxelEvent.fSubEventID = subEventID;
+
+    voxelEvent.fX.reserve(fVoxels.size());
+    voxelEvent.fY.reserve(fVoxels.size());
+    voxelEvent.fZ.reserve(fVoxels.size());
+    voxelEvent.fEnergy.reserve(fVoxels.size());
+
+    for (const auto& [key, energy] : fVoxels) {
+        voxelEvent.fX.push_back(get<0>(key));
+        voxelEvent.fY.push_back(get<1>(key));
+        voxelEvent.fZ.push_back(get<2>(key));
+        voxelEvent.fEnergy.push_back(energy);
+    }
+
+    return voxelEvent;
+}
+
+string HitVoxelizer::ToString() const {
+    return TString::Format("voxelSize=(%g,%g,%g)mm voxelOrigin=(%g,%g,%g)mm voxelRotation=(%g,%g,%g)deg",
+                           fVoxelSize.X(), fVoxelSize.Y(), fVoxelSize.Z(), fOrigin.X(), fOrigin.Y(),
+                           fOrigin.Z(), fRotation.X(), fRotation.Y(), fRotation.Z())
+        .Data();
+}
@@ -0,0 +1,216 @@
+
+#include "ImportanceMap.h"
+
+#include <TFile.h>
+#include <TH3D.h>
+#include <TString.h>
+
+#include <G4LogicalVolume.hh>
+#include <G4VPhysicalVolume.hh>
+#include <G4VSolid.hh>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "VoxelTraversal.h"
+
+using namespace std;
+
+ImportanceMap::ImportanceMap(const TVector3& bins, const TVector3& minimum, const TVector3& maximum)
+    : fBins{Int_t(bins.X()), Int_t(bins.Y()), Int_t(bins.Z())}, fMinimum(minimum), fMaximum(maximum) {
+    if (fBins[0] <= 0 || fBins[1] <= 0 || fBins[2] <= 0) {
+        cerr << "ImportanceMap - number of bins must be positive in all dimensions" << endl;
+        exit(1);
+    }
+    if (HasBounds() &&
+        (fMaximum.X() <= fMinimum.X() || fMaximum.Y() <= fMinimum.Y() || fMaximum.Z() <= fMinimum.Z())) {
+        cerr << "ImportanceMap - mesh maximum must be larger than the minimum in all dimensions" << endl;
+        exit(1);
+    }
+    const size_t numberOfCells = size_t(fBins[0]) * fBins[1] * fBins[2];
+    fPopulation.resize(numberOfCells, 0);
+    fContribution.resize(numberOfCells, 0);
+}
+
+void ImportanceMap::SetBoundsFromWorld(const G4VPhysicalVolume* world) {
+    G4ThreeVector minimum, maximum;
+    world->GetLogicalVolume()->GetSolid()->BoundingLimits(minimum, maximum);
+    fMinimum = {minimum.x(), minimum.y(), minimum.z()};
+    fMaximum = {maximum.x(), maximum.y(), maximum.z()};
+}
+
+Int_t ImportanceMap::GetCell(const G4ThreeVector& position) const {
+    Int_t index[3];
+    const Double_t coordinates[3] = {position.x(), position.y(), position.z()};
+    for (int i = 0; i < 3; i++) {
+        const Double_t fraction = (coordinates[i] - fMinimum[i]) / (fMaximum[i] - fMinimum[i]);
+        if (fraction < 0 || fraction >= 1) {
+            return -1;
+        }
+        index[i] = Int_t(fraction * fBins[i]);
+    }
+    return (index[2] * fBins[1] + index[1]) * fBins[0] + index[0];
+}
+
+void ImportanceMap::AddCrossedCells(const G4ThreeVector& start, const G4ThreeVector& end,
+                                    vector<Int_t>& cells) const {
+    const auto addCell = [&cells](Int_t cell) {
+        if (cell >= 0 && (cells.empty() || cells.back() != cell)) {
+            cells.push_back(cell);
+        }
+    };
+    if (start == end) {
+        addCell(GetCell(start));
+        return;
+    }
+
+    const Double_t origin[3] = {start.x() - fMinimum.X(), start.y() - fMinimum.Y(), start.z() - fMinimum.Z()};
+    const Double_t delta[3] = {end.x() - start.x(), end.y() - start.y(), end.z() - start.z()};
+    Double_t cellSize[3];
+    for (int i = 0; i < 3; i++) {
+        cellSize[i] = (fMaximum[i] - fMinimum[i]) / fBins[i];
+    }
+    TraverseVoxels(origin, delta, cellSize, fBins, [&](const Int_t index[3], Double_t) {
+        addCell((index[2] * fBins[1] + index[1]) * fBins[0] + index[0]);
+    });
+}
+
+void ImportanceMap::AddEvent(const unordered_map<Int_t, Double_t>& population,
+                             const unordered_map<Int_t, Double_t>& contribution) {
+    lock_guard<mutex> guard(fMutex);
+    fNumberOfEvents++;
+    for (const auto& [cell, value] : population) {
+        fPopulation[cell] += value;
+    }
+    for (const auto& [cell, value] : contribution) {
+        fContribution[cell] += value;
+    }
+}
+
+void ImportanceMap::Write(const string& filename) {
+    lock_guard<mutex> guard(fMutex);
+
+    TDirectory::TContext context;  // restores the current directory, the run output file
+    TFile file(filename.c_str(), "RECREATE");
+    if (file.IsZombie()) {
+        cerr << "ImportanceMap - Unable to open importance map file '" << filename << "' for writing" << endl;
+        exit(1);
+    }
+
+    const auto makeHistogram = [this](const char* name, const char* title) {
+        TH3D histogram(name, title, fBins[0], fMinimum.X(), fMaximum.X(), fBins[1], fMinimum.Y(),
+                       fMaximum.Y(), fBins[2], fMinimum.Z(), fMaximum.Z());
+        histogram.SetDirectory(nullptr);
+        histogram.GetXaxis()->SetTitle("X (mm)");
+        histogram.GetYaxis()->SetTitle("Y (mm)");
+        histogram.GetZaxis()->SetTitle("Z (mm)");
+        return histogram;
+    };
+    auto population = makeHistogram("Population", "Tracks visiting the cell");
+    auto contribution =
+        makeHistogram("Contribution", "Tracks visiting the cell that contribute to sensitive deposits");
+    auto importance = makeHistogram("Importance", "Contribution / population, normalized to the maximum");
+
+    const Double_t maximumRatio = GetMaximumRatio();
+
+    for (Int_t z = 0; z < fBins[2]; z++) {
+        for (Int_t y = 0; y < fBins[1]; y++) {
+            for (Int_t x = 0; x < fBins[0]; x++) {
+                const size_t cell = (size_t(z) * fBins[1] + y) * fBins[0] + x;
+                population.SetBinContent(x + 1, y + 1, z + 1, fPopulation[cell]);
+                contribution.SetBinContent(x + 1, y + 1, z + 1, fContribution[cell]);
+                if (fPopulation[cell] > 0 && maximumRatio > 0) {
+                    importance.SetBinContent(x + 1, y + 1, z + 1,
+                                             fContribution[cell] / fPopulation[cell] / maximumRatio);
+                }
+            }
+        }
+    }
+
+    population.Write();
+    contribution.Write();
+    importance.Write();
+    file.Close();
+
+    cout << "Importance map written to '" << filename << "' from " << fNumberOfEvents << " events" << endl;
+}
+
+unique_ptr<ImportanceMap> ImportanceMap::Read(const string& filename) {
+    TDirectory::TContext context;
+    TFile file(filename.c_str(), "READ");
+    if (file.IsZombie()) {
+        cerr << "ImportanceMap - Unable to open importance map file '" << filename << "'" << endl;
+        exit(1);
+    }
+    const auto population = file.Get<TH3D>("Population");
+    const auto contribution = file.Get<TH3D>("Contribution");
+    if (population == nullptr || contribution == nullptr) {
+        cerr << "ImportanceMap - '" << filename << "' does not contain an importance map" << endl;
+        exit(1);
+    }
+
+    const TAxis* axes[3] = {population->GetXaxis(), population->GetYaxis(), population->GetZaxis()};
+    const TVector3 bins(axes[0]->GetNbins(), axes[1]->GetNbins(), axes[2]->GetNbins());
+    const TVector3 minimum(axes[0]->GetXmin(), axes[1]->GetXmin(), axes[2]->GetXmin());
+    const TVector3 maximum(axes[0]->GetXmax(), axes[1]->GetXmax(), axes[2]->GetXmax());
+    auto map = make_unique<ImportanceMap>(bins, minimum, maximum);
+    for (Int_t z = 0; z < map->fBins[2]; z++) {
+        for (Int_t y = 0; y < map->fBins[1]; y++) {
+            for (Int_t x = 0; x < map->fBins[0]; x++) {
+                const size_t cell = (size_t(z) * map->fBins[1] + y) * map->fBins[0] + x;
+                map->fPopulation[cell] = population->GetBinContent(x + 1, y + 1, z + 1);
+                map->fContribution[cell] = contribution->GetBinContent(x + 1, y + 1, z + 1);
+            }
+        }
+    }
+    map->fImportances = map->GetImportances();
+    return map;
+}
+
+Double_t ImportanceMap::GetMaximumRatio() const {
+    Double_t maximum = 0;
+    for (size_t cell = 0; cell < fPopulation.size(); cell++) {
+        if (fPopulation[cell] > 0) {
+            maximum = max(maximum, fContribution[cell] / fPopulation[cell]);
+        }
+    }
+    return maximum;
+}
+
+vector<Double_t> ImportanceMap::GetImportances() const {
+    lock_guard<mutex> guard(fMutex);
+
+    const Double_t maximumRatio = GetMaximumRatio();
+    if (maximumRatio <= 0) {
+        return {};
+    }
+    vector<Double_t> importances(fPopulation.size(), 0);
+    Double_t minimum = 1;
+    for (size_t cell = 0; cell < fPopulation.size(); cell++) {
+        if (fPopulation[cell] > 0 && fContribution[cell] > 0) {
+            importances[cell] = fContribution[cell] / fPopulation[cell] / maximumRatio;
+            minimum = min(minimum, importances[cell]);
+        }
+    }
+    for (auto& importance : importances) {
+        if (importance == 0) {
+            importance = minimum;
+        }
+    }
+    return importances;
+}
+
+Double_t ImportanceMap::GetImportance(const G4ThreeVector& position) const {
+    const Int_t cell = GetCell(position);
+    if (cell < 0 || fImportances.empty()) {
+        return -1;
+    }
+    return fImportances[cell];
+}
+
+string ImportanceMap::ToString() const {
+    return TString::Format("bins=(%d,%d,%d) minimum=(%g,%g,%g)mm maximum=(%g,%g,%g)mm", fBins[0], fBins[1],
+                           fBins[2], fMinimum.X(), fMinimum.Y(), fMinimum.Z(), fMaximum.X(), fMaximum.Y(),
+                           fMaximum.Z())
+        .Data();
+}
@@ -0,0 +1,114 @@
+
+#include "MaterialScan.h"
+
+#include <TDirectory.h>
+#include <TMath.h>
+#include <TString.h>
+
+#include <G4SystemOfUnits.hh>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+constexpr const char* totalMapName = "Total";
+}
+
+MaterialScan::MaterialScan(const Parameters& parameters) : fParameters(parameters) {
+    if (fParameters.fBinsX <= 0 || fParameters.fBinsY <= 0) {
+        cerr << "MaterialScan - number of bins must be positive" << endl;
+        exit(1);
+    }
+    if (fParameters.fRangeX.X() >= fParameters.fRangeX.Y() ||
+        fParameters.fRangeY.X() >= fParameters.fRangeY.Y()) {
+        cerr << "MaterialScan - ranges must be given as (min,max) with min < max" << endl;
+        exit(1);
+    }
+    if (fParameters.fDirection.Mag() == 0) {
+        cerr << "MaterialScan - scan direction cannot be null" << endl;
+        exit(1);
+    }
+    const TVector3 direction = fParameters.fDirection.Unit();
+    fAxis = {direction.X(), direction.Y(), direction.Z()};
+    fAxisU = fAxis.orthogonal().unit();
+    fAxisV = fAxis.cross(fAxisU);
+}
+
+void MaterialScan::GetRay(size_t ray, G4ThreeVector& position, G4ThreeVector& direction) const {
+    const auto& p = fParameters;
+    // center of the bin, rays are ordered along Y first
+    const Double_t x =
+        p.fRangeX.X() + (Double_t(ray / p.fBinsY) + 0.5) * (p.fRangeX.Y() - p.fRangeX.X()) / p.fBinsX;
+    const Double_t y =
+        p.fRangeY.X() + (Double_t(ray % p.fBinsY) + 0.5) * (p.fRangeY.Y() - p.fRangeY.X()) / p.fBinsY;
+
+    const G4ThreeVector origin = {p.fOrigin.X() * mm, p.fOrigin.Y() * mm, p.fOrigin.Z() * mm};
+    if (p.fMode == Mode::Point) {
+        const Double_t theta = x * TMath::DegToRad();
+        const Double_t phi = y * TMath::DegToRad();
+        position = origin;
+        direction = sin(theta) * cos(phi) * fAxisU + sin(theta) * sin(phi) * fAxisV + cos(theta) * fAxis;
+    } else {
+        position = origin + x * mm * fAxisU + y * mm * fAxisV;
+        direction = fAxis;
+    }
+}
+
+TH2D& MaterialScan::GetMap(map<string, TH2D>& maps, const string& name, const string& title) {
+    auto it = maps.find(name);
+    if (it != maps.end()) {
+        return it->second;
+    }
+    const auto& p = fParameters;
+    const string axisTitles = p.fMode == Mode::Point ? ";#theta (deg);#phi (deg)" : ";u (mm);v (mm)";
+    auto& histogram = maps.try_emplace(name, name.c_str(), (title + axisTitles).c_str(), p.fBinsX,
+                                       p.fRangeX.X(), p.fRangeX.Y(), p.fBinsY, p.fRangeY.X(), p.fRangeY.Y())
+                          .first->second;
+    histogram.SetDirectory(nullptr);
+    return histogram;
+}
+
+void MaterialScan::AddRay(size_t ray, const map<string, Double_t>& volumePathLengths,
+                          const map<string, Double_t>& materialArealDensities) {
+    const Int_t binX = Int_t(ray / fParameters.fBinsY) + 1;
+    const Int_t binY = Int_t(ray % fParameters.fBinsY) + 1;
+
+    lock_guard<mutex> guard(fMutex);
+
+    for (const auto& [volume, length] : volumePathLengths) {
+        GetMap(fVolumeMaps, volume, "Path length (mm) in volume " + volume).SetBinContent(binX, binY, length);
+    }
+    Double_t total = 0;
+    for (const auto& [material, density] : materialArealDensities) {
+        GetMap(fMaterialMaps, material, "Areal density (g/cm2) of material " + material)
+            .SetBinContent(binX, binY, density);
+        total += density;
+    }
+    GetMap(fMaterialMaps, totalMapName, "Total areal density (g/cm2)").SetBinContent(binX, binY, total);
+}
+
+void MaterialScan::Write() {
+    lock_guard<mutex> guard(fMutex);
+
+    TDirectory* previousDirectory = gDirectory;
+    auto directory = gDirectory->mkdir("MaterialScan", "", true);
+    directory->mkdir("Volumes", "", true)->cd();
+    for (auto& [name, histogram] : fVolumeMaps) {
+        histogram.Write(name.c_str(), TObject::kOverwrite);
+    }
+    directory->mkdir("Materials", "", true)->cd();
+    for (auto& [name, histogram] : fMaterialMaps) {
+        histogram.Write(name.c_str(), TObject::kOverwrite);
+    }
+    previousDirectory->cd();
+}
+
+string MaterialScan::ToString() const {
+    const auto& p = fParameters;
+    return TString::Format("mode=%s origin=(%g,%g,%g)mm direction=(%g,%g,%g) bins=(%d,%d) rangeX=(%g,%g) "
+                           "rangeY=(%g,%g)",
+                           p.fMode == Mode::Point ? "point" : "plane", p.fOrigin.X(), p.fOrigin.Y(),
+                           p.fOrigin.Z(), p.fDirection.X(), p.fDirection.Y(), p.fDirection.Z(), p.fBinsX,
+                           p.fBinsY, p.fRangeX.X(), p.fRangeX.Y(), p.fRangeY.X(), p.fRangeY.Y())
+        .Data();
+}
@@ -0,0 +1,165 @@
+
+#include "MeshTally.h"
+
+#include <TDirectory.h>
+#include <TH3D.h>
+#include <TString.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "VoxelTraversal.h"
+
+using namespace std;
+
+MeshTally::MeshTally(const Parameters& parameters) : fParameters(parameters) {
+    for (int i = 0; i < 3; i++) {
+        if (fParameters.fBins[i] <= 0) {
+            cerr << "MeshTally - '" << fParameters.fName
+                 << "' number of bins must be positive in all dimensions" << endl;
+            exit(1);
+        }
+        if (fParameters.fMaximum[i] <= fParameters.fMinimum[i]) {
+            cerr << "MeshTally - '" << fParameters.fName
+                 << "' maximum must be larger than the minimum in all dimensions" << endl;
+            exit(1);
+        }
+        fVoxelSize[i] = (fParameters.fMaximum[i] - fParameters.fMinimum[i]) / fParameters.fBins[i];
+    }
+    const auto& particles = fParameters.fTrackLengthParticles;
+    for (size_t i = 0; i < particles.size(); i++) {
+        if (find(particles.begin() + i + 1, particles.end(), particles[i]) != particles.end()) {
+            // a step matches at most its particle and "all"
+            cerr << "MeshTally - '" << fParameters.fName << "' track length particle '" << particles[i]
+                 << "' is repeated" << endl;
+            exit(1);
+        }
+    }
+    fEnergy.resize(GetNumberOfVoxels(), 0);
+    fTrackLength.resize(fParameters.fTrackLengthParticles.size(), vector<Double_t>(GetNumberOfVoxels(), 0));
+}
+
+MeshTally::Grid::Grid(const MeshTally& tally)
+    : fTally(tally),
+      fEnergy(tally.GetNumberOfVoxels(), 0),
+      fTrackLength(tally.fParameters.fTrackLengthParticles.size(),
+                   vector<Double_t>(tally.GetNumberOfVoxels(), 0)) {}
+
+void MeshTally::Grid::Fill(const G4ThreeVector& start, const G4ThreeVector& end, Double_t continuousEnergy,
+                           Double_t localEnergy, const string& particleName) {
+    const auto& parameters = fTally.fParameters;
+    const auto& voxelSize = fTally.fVoxelSize;
+    const Int_t* bins = parameters.fBins;
+
+    vector<Double_t>* trackLength[2] = {nullptr, nullptr};  // particle and "all"
+    int numberOfTrackLengths = 0;
+    for (size_t i = 0; i < parameters.fTrackLengthParticles.size(); i++) {
+        const auto& particle = parameters.fTrackLengthParticles[i];
+        if (particle == particleName || particle == "all") {
+            trackLength[numberOfTrackLengths++] = &fTrackLength[i];
+        }
+    }
+
+    const Double_t origin[3] = {start.x() - parameters.fMinimum.X(), start.y() - parameters.fMinimum.Y(),
+                                start.z() - parameters.fMinimum.Z()};
+    const Double_t delta[3] = {end.x() - start.x(), end.y() - start.y(), end.z() - start.z()};
+    const Double_t length = sqrt(delta[0] * delta[0] + delta[1] * delta[1] + delta[2] * delta[2]);
+
+    const auto voxelIndex = [&](const Int_t index[3]) {
+        return (size_t(index[2]) * bins[1] + index[1]) * bins[0] + index[0];
+    };
+
+    // energy of the step point
+    const auto fillPoint = [&](const G4ThreeVector& position, Double_t energy) {
+        const Double_t local[3] = {position.x() - parameters.fMinimum.X(),
+                                   position.y() - parameters.fMinimum.Y(),
+                                   position.z() - parameters.fMinimum.Z()};
+        Int_t index[3];
+        for (int i = 0; i < 3; i++) {
+            index[i] = Int_t(floor(local[i] / voxelSize[i]));
+            if (index[i] < 0 || index[i] >= bins[i]) {
+                return;
+            }
+        }
+        fEnergy[voxelIndex(index)] += energy;
+    };
+
+    if (localEnergy != 0) {
+        fillPoint(end, localEnergy);
+    }
+    if (length == 0) {
+        // deposit at rest
+        if (continuousEnergy != 0) {
+            fillPoint(start, continuousEnergy);
+        }
+        return;
+    }
+
+    TraverseVoxels(origin, delta, voxelSize, bins, [&](const Int_t index[3], Double_t fraction) {
+        const size_t voxel = voxelIndex(index);
+        fEnergy[voxel] += continuousEnergy * fraction;
+        for (int i = 0; i < numberOfTrackLengths; i++) {
+            (*trackLength[i])[voxel] += length * fraction;
+        }
+    });
+}
+
+void MeshTally::Merge(const Grid& grid) {
+    lock_guard<mutex> guard(fMutex);
+    for (size_t voxel = 0; voxel < fEnergy.size(); voxel++) {
+        fEnergy[voxel] += grid.fEnergy[voxel];
+    }
+    for (size_t i = 0; i < fTrackLength.size(); i++) {
+        for (size_t voxel = 0; voxel < fEnergy.size(); voxel++) {
+            fTrackLength[i][voxel] += grid.fTrackLength[i][voxel];
+        }
+    }
+}
+
+void MeshTally::Write() {
+    lock_guard<mutex> guard(fMutex);
+
+    TDirectory* previousDirectory = gDirectory;
+    gDirectory->mkdir("MeshTallies", "", true)->cd();
+
+    const auto& p = fParameters;
+    const auto writeHistogram = [&](const string& name, const string& title, const vector<Double_t>& values) {
+        TH3D histogram(name.c_str(), title.c_str(), p.fBins[0], p.fMinimum.X(), p.fMaximum.X(), p.fBins[1],
+                       p.fMinimum.Y(), p.fMaximum.Y(), p.fBins[2], p.fMinimum.Z(), p.fMaximum.Z());
+        histogram.SetDirectory(nullptr);
+        histogram.GetXaxis()->SetTitle("X (mm)");
+        histogram.GetYaxis()->SetTitle("Y (mm)");
+        histogram.GetZaxis()->SetTitle("Z (mm)");
+        for (Int_t z = 0; z < p.fBins[2]; z++) {
+            for (Int_t y = 0; y < p.fBins[1]; y++) {
+                for (Int_t x = 0; x < p.fBins[0]; x++) {
+                    histogram.SetBinContent(x + 1, y + 1, z + 1,
+                                            values[(size_t(z) * p.fBins[1] + y) * p.fBins[0] + x]);
+                }
+            }
+        }
+        histogram.Write(name.c_str(), TObject::kOverwrite);
+    };
+
+    writeHistogram(p.fName + "_Energy", "Deposited energy (keV) in " + p.fName, fEnergy);
+    for (size_t i = 0; i < p.fTrackLengthParticles.size(); i++) {
+        const auto& particle = p.fTrackLengthParticles[i];
+        writeHistogram(p.fName + "_TrackLength_" + particle,
+                       "Track length (mm) of " + particle + " particles in " + p.fName, fTrackLength[i]);
+    }
+    previousDirectory->cd();
+}
+
+string MeshTally::ToString() const {
+    const auto& p = fParameters;
+    string trackLengthParticles;
+    for (const auto& particle : p.fTrackLengthParticles) {
+        trackLengthParticles += (trackLengthParticles.empty() ? "" : ",") + particle;
+    }
+    return TString::Format("name=%s bins=(%d,%d,%d) minimum=(%g,%g,%g)mm maximum=(%g,%g,%g)mm trackLength=%s",
+                           p.fName.c_str(), p.fBins[0], p.fBins[1], p.fBins[2], p.fMinimum.X(),
+                           p.fMinimum.Y(), p.fMinimum.Z(), p.fMaximum.X(), p.fMaximum.Y(), p.fMaximum.Z(),
+                           trackLengthParticles.empty() ? "none" : trackLengthParticles.c_str())
+        .Data();
+}
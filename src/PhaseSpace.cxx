@@ -0,0 +1,111 @@
+
+#include "PhaseSpace.h"
+
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+constexpr char phaseSpaceMagic[8] = {'R', 'G', '4', 'P', 'H', 'S', 'P', '1'};
+constexpr uint32_t phaseSpaceRecordSize = sizeof(PhaseSpaceRecord);
+constexpr streamoff phaseSpaceHeaderSize =
+    sizeof(phaseSpaceMagic) + sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint64_t);
+}  // namespace
+
+PhaseSpaceWriter::PhaseSpaceWriter(const string& filename)
+    : fFilename(filename), fFile(filename, ios::binary | ios::trunc) {
+    if (!fFile.is_open()) {
+        cerr << "PhaseSpaceWriter - Unable to open phase space file '" << filename << "' for writing" << endl;
+        exit(1);
+    }
+    // header is written again with the final values on close
+    const uint64_t zero = 0;
+    fFile.write(phaseSpaceMagic, sizeof(phaseSpaceMagic));
+    fFile.write(reinterpret_cast<const char*>(&phaseSpaceRecordSize), sizeof(phaseSpaceRecordSize));
+    fFile.write(reinterpret_cast<const char*>(&zero), sizeof(zero));
+    fFile.write(reinterpret_cast<const char*>(&zero), sizeof(zero));
+}
+
+PhaseSpaceWriter::~PhaseSpaceWriter() {
+    if (fFile.is_open()) {
+        fFile.close();
+    }
+}
+
+void PhaseSpaceWriter::Write(const vector<PhaseSpaceRecord>& records) {
+    if (records.empty()) {
+        return;
+    }
+    lock_guard<mutex> guard(fMutex);
+    fFile.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(PhaseSpaceRecord));
+    fNumberOfRecords += records.size();
+}
+
+void PhaseSpaceWriter::Close(uint64_t numberOfPrimaries) {
+    lock_guard<mutex> guard(fMutex);
+    if (!fFile.is_open()) {
+        return;
+    }
+    fFile.seekp(sizeof(phaseSpaceMagic) + sizeof(phaseSpaceRecordSize));
+    fFile.write(reinterpret_cast<const char*>(&numberOfPrimaries), sizeof(numberOfPrimaries));
+    fFile.write(reinterpret_cast<const char*>(&fNumberOfRecords), sizeof(fNumberOfRecords));
+    fFile.close();
+
+    cout << "Phase space file '" << fFilename << "' written with " << fNumberOfRecords << " records from "
+         << numberOfPrimaries << " primaries" << endl;
+}
+
+PhaseSpaceReader::PhaseSpaceReader(const string& filename, int recycling)
+    : fFilename(filename), fFile(filename, ios::binary), fRecycling(recycling) {
+    if (!fFile.is_open()) {
+        cerr << "PhaseSpaceReader - Unable to open phase space file '" << filename << "'" << endl;
+        exit(1);
+    }
+    if (fRecycling < 1) {
+        cerr << "PhaseSpaceReader - recycling must be >= 1" << endl;
+        exit(1);
+    }
+
+    char magic[sizeof(phaseSpaceMagic)];
+    uint32_t recordSize = 0;
+    fFile.read(magic, sizeof(magic));
+    fFile.read(reinterpret_cast<char*>(&recordSize), sizeof(recordSize));
+    fFile.read(reinterpret_cast<char*>(&fNumberOfPrimaries), sizeof(fNumberOfPrimaries));
+    fFile.read(reinterpret_cast<char*>(&fNumberOfRecords), sizeof(fNumberOfRecords));
+
+    if (!fFile || memcmp(magic, phaseSpaceMagic, sizeof(magic)) != 0 || recordSize != phaseSpaceRecordSize) {
+        cerr << "PhaseSpaceReader - '" << filename << "' is not a valid phase space file" << endl;
+        exit(1);
+    }
+    if (fNumberOfRecords == 0) {
+        cerr << "PhaseSpaceReader - phase space file '" << filename << "' has no records" << endl;
+        exit(1);
+    }
+
+    cout << "Phase space file '" << filename << "' contains " << fNumberOfRecords << " records from "
+         << fNumberOfPrimaries << " primaries. Each record will be used " << fRecycling << " times" << endl;
+}
+
+PhaseSpaceRecord PhaseSpaceReader::Next() {
+    lock_guard<mutex> guard(fMutex);
+
+    if (fUses > 0 && fUses < fRecycling) {
+        fUses++;
+        return fCurrentRecord;
+    }
+
+    if (fNextRecord >= fNumberOfRecords) {
+        cout << "PhaseSpaceReader - All records of '" << fFilename << "' have been used, starting over"
+             << endl;
+        fFile.clear();
+        fFile.seekg(phaseSpaceHeaderSize);
+        fNextRecord = 0;
+    }
+
+    fFile.read(reinterpret_cast<char*>(&fCurrentRecord), sizeof(fCurrentRecord));
+    fNextRecord++;
+    fUses = 1;
+
+    return fCurrentRecord;
+}
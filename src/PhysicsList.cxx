@@ -10,8 +10,10 @@
 #include <G4EmLivermorePhysics.hh>
 #include <G4EmParameters.hh>
 #include <G4EmPenelopePhysics.hh>
+#include <G4EmStandardPhysics.hh>
 #include <G4EmStandardPhysics_option3.hh>
 #include <G4EmStandardPhysics_option4.hh>
+#include <G4FastSimulationManagerProcess.hh>
 #include <G4HadronElasticPhysics.hh>
 #include <G4HadronElasticPhysicsHP.hh>
 #include <G4HadronPhysicsQGSP_BIC_HP.hh>
@@ -32,11 +34,13 @@
 #include <G4StepLimiter.hh>
 #include <G4StoppingPhysics.hh>
 #include <G4SystemOfUnits.hh>
+#include <G4Threading.hh>
 #include <G4UAtomicDeexcitation.hh>
 #include <G4UImanager.hh>
 #include <G4UnitsTable.hh>
 #include <G4UniversalFluctuation.hh>
 
+#include "DetectorConstruction.h"
 #include "Particles.h"
 
 using namespace std;
@@ -88,39 +92,30 @@ void PhysicsList::InitializePhysicsLists() {
         G4cout << "restG4. PhysicsList. G4RadioactiveDecayPhysics is not enabled!!" << G4endl;
     }
 
-    // Electromagnetic physicsList
+    // Electromagnetic physicsList. Lists with the 'regions' option are only used in those regions, on top of
+    // the global one. Names of the EM constructors as known by G4EmModelActivator
+    const vector<pair<string, string> > emPhysicsLists = {
+        {"G4EmLivermorePhysics", "G4EmLivermore"},
+        {"G4EmPenelopePhysics", "G4EmPenelope"},
+        {"G4EmStandardPhysics", "G4EmStandard"},
+        {"G4EmStandardPhysics_option3", "G4EmStandard_opt3"},
+        {"G4EmStandardPhysics_option4", "G4EmStandard_opt4"},
+    };
     int emCounter = 0;
-    auto emPhysicsListName = "G4EmLivermorePhysics";
-    if (fRestPhysicsLists->FindPhysicsList(emPhysicsListName) >= 0) {
-        if (fEmPhysicsList == nullptr) {
-            fEmPhysicsList = new G4EmLivermorePhysics();
-            fEmPhysicsListName = emPhysicsListName;
+    for (const auto& [emPhysicsListName, emPhysicsType] : emPhysicsLists) {
+        if (fRestPhysicsLists->FindPhysicsList(emPhysicsListName.c_str()) < 0) {
+            continue;
         }
-        emCounter++;
-    }
-
-    emPhysicsListName = "G4EmPenelopePhysics";
-    if (fRestPhysicsLists->FindPhysicsList(emPhysicsListName) >= 0) {
-        if (fEmPhysicsList == nullptr) {
-            fEmPhysicsList = new G4EmPenelopePhysics();
-            fEmPhysicsListName = emPhysicsListName;
+        const TString regions =
+            fRestPhysicsLists->GetPhysicsListOptionValue(emPhysicsListName.c_str(), "regions", "");
+        if (regions != "") {
+            for (const auto& region : Split(RemoveWhiteSpaces(regions.Data()), ",")) {
+                fEmRegionPhysics.emplace_back(region, emPhysicsType);
+            }
+            continue;
         }
-        emCounter++;
-    }
-
-    emPhysicsListName = "G4EmStandardPhysics_option3";
-    if (fRestPhysicsLists->FindPhysicsList(emPhysicsListName) >= 0) {
         if (fEmPhysicsList == nullptr) {
-            fEmPhysicsList = new G4EmStandardPhysics_option3();
-            fEmPhysicsListName = emPhysicsListName;
-        }
-        emCounter++;
-    }
-
-    emPhysicsListName = "G4EmStandardPhysics_option4";
-    if (fRestPhysicsLists->FindPhysicsList(emPhysicsListName) >= 0) {
-        if (fEmPhysicsList == nullptr) {
-            fEmPhysicsList = new G4EmStandardPhysics_option4();
+            fEmPhysicsList = CreateEmPhysicsList(emPhysicsListName);
             fEmPhysicsListName = emPhysicsListName;
         }
         emCounter++;
@@ -136,6 +131,13 @@ void PhysicsList::InitializePhysicsLists() {
         exit(1);
     }
 
+    if (emCounter == 0 && !fEmRegionPhysics.empty()) {
+        cerr << "PhysicsList: EM PhysicsLists for regions require a global EM PhysicsList (without the "
+                "'regions' option)"
+             << endl;
+        exit(1);
+    }
+
     // Hadronic PhysicsList
     if (fRestPhysicsLists->FindPhysicsList("G4HadronPhysicsQGSP_BIC_HP") >= 0) {
         fHadronPhys.push_back(new G4HadronPhysicsQGSP_BIC_HP());
@@ -160,6 +162,35 @@ void PhysicsList::InitializePhysicsLists() {
     G4cout << "Number of hadronic physics lists added " << fHadronPhys.size() << G4endl;
 }
 
+G4VPhysicsConstructor* PhysicsList::CreateEmPhysicsList(const string& name) {
+    if (name == "G4EmLivermorePhysics") {
+        return new G4EmLivermorePhysics();
+    } else if (name == "G4EmPenelopePhysics") {
+        return new G4EmPenelopePhysics();
+    } else if (name == "G4EmStandardPhysics") {
+        return new G4EmStandardPhysics();
+    } else if (name == "G4EmStandardPhysics_option3") {
+        return new G4EmStandardPhysics_option3();
+    } else if (name == "G4EmStandardPhysics_option4") {
+        return new G4EmStandardPhysics_option4();
+    }
+    cerr << "PhysicsList: Unknown EM PhysicsList '" << name << "'" << endl;
+    exit(1);
+}
+
+void PhysicsList::ConfigureEmRegionPhysics() const {
+    // shared parameters, set once by the master before the EM constructors activate the models
+    if (!G4Threading::IsMasterThread()) {
+        return;
+    }
+    auto emParameters = G4EmParameters::Instance();
+    for (const auto& [regionName, emPhysicsType] : fEmRegionPhysics) {
+        DetectorConstruction::FindOrCreateRegion(regionName);
+        G4cout << "Using EM physics '" << emPhysicsType << "' in region '" << regionName << "'" << G4endl;
+        emParameters->AddPhysics(regionName, emPhysicsType);
+    }
+}
+
 void PhysicsList::ConstructParticle() {
     // pseudo-particles
     G4Geantino::GeantinoDefinition();
@@ -187,6 +218,7 @@ void PhysicsList::ConstructProcess() {
 
     // Electromagnetic physics list
     if (fEmPhysicsList) {
+        ConfigureEmRegionPhysics();
         fEmPhysicsList->ConstructProcess();
         fEmConfig.AddModels();
 
@@ -271,6 +303,10 @@ void PhysicsList::ConstructProcess() {
         const auto& particleName = particle->GetParticleName();
         G4ProcessManager* processManager = particle->GetProcessManager();
 
+        if (fFastSimulation && (particleName == "e-" || particleName == "e+" || particleName == "gamma")) {
+            processManager->AddDiscreteProcess(new G4FastSimulationManagerProcess());
+        }
+
         if (particleName == "e-") {
             processManager->AddDiscreteProcess(new G4StepLimiter("e-Step"));
         } else if (particleName == "e+") {
@@ -9,13 +9,18 @@
 #include <G4Event.hh>
 #include <G4Geantino.hh>
 #include <G4IonTable.hh>
+#include <G4Log.hh>
 #include <G4ParticleDefinition.hh>
 #include <G4ParticleTable.hh>
+#include <G4PrimaryParticle.hh>
+#include <G4PrimaryVertex.hh>
+#include <G4RandomDirection.hh>
 #include <G4RunManager.hh>
 #include <G4SystemOfUnits.hh>
 #include <G4UnitsTable.hh>
 #include <Randomize.hh>
 
+#include "RandomEngine.h"
 #include "SimulationManager.h"
 
 using namespace std;
@@ -34,7 +39,7 @@ PrimaryGeneratorAction::PrimaryGeneratorAction(SimulationManager* simulationMana
     const string energyDistTypeName = source->GetEnergyDistributionType().Data();
     const auto energyDistTypeEnum = StringToEnergyDistributionTypes(energyDistTypeName);
 
-    fRandom = new TRandom(restG4Metadata->GetSeed() + TRandom(G4Threading::G4GetThreadId()).Integer(1E9));
+    fRandom = new Geant4TRandom();
 
     if (energyDistTypeEnum == EnergyDistributionTypes::TH1D) {
         Double_t minEnergy = source->GetEnergyDistributionRangeMin();
@@ -63,6 +68,11 @@ PrimaryGeneratorAction::PrimaryGeneratorAction(SimulationManager* simulationMana
     } else if (angularDistTypeEnum == AngularDistributionTypes::FORMULA) {
         fAngularDistributionFunction = (TF1*)source->GetAngularDistributionFunction()->Clone();
     }
+
+    if (fSimulationManager->GetDecayLibrarySize() > 0) {
+        fDecayLibrary = make_unique<DecayLibrary>(fSimulationManager->GetDecayLibrarySize(),
+                                                  fSimulationManager->GetRestMetadata()->GetSeed());
+    }
 }
 
 PrimaryGeneratorAction::~PrimaryGeneratorAction() = default;
@@ -124,6 +134,23 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event* event) {
     if (restG4Metadata->GetVerboseLevel() >= TRestStringOutput::REST_Verbose_Level::REST_Debug) {
         cout << "DEBUG: Primary generation" << endl;
     }
+
+    if (simulationManager->GetMaterialScan() != nullptr) {
+        G4ThreeVector position, direction;
+        simulationManager->GetMaterialScan()->GetRay(event->GetEventID(), position, direction);
+        fParticleGun.SetParticleDefinition(G4Geantino::Definition());
+        fParticleGun.SetParticlePosition(position);
+        fParticleGun.SetParticleMomentumDirection(direction);
+        fParticleGun.SetParticleEnergy(1 * MeV);
+        fParticleGun.GeneratePrimaryVertex(event);
+        return;
+    }
+
+    if (simulationManager->GetPhaseSpaceReader() != nullptr) {
+        // restart from a previous simulation stage, generator sources are ignored
+        GeneratePrimaryFromPhaseSpace(event);
+        return;
+    }
     // We have to initialize here and not in start of the event because
     // GeneratePrimaries is called first, and we want to store event origin and
     // position inside
@@ -148,11 +175,86 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event* event) {
             // Particle Direction must be always set before energy
             SetParticleEnergy(i, p);
             SetParticleDirection(i, p);
+            if (fDecayLibrary && fParticleGun.GetParticleEnergy() == 0 &&
+                GeneratePrimariesFromDecayLibrary(event)) {
+                continue;
+            }
             fParticleGun.GeneratePrimaryVertex(event);
         }
     }
 }
 
+void PrimaryGeneratorAction::GeneratePrimaryFromPhaseSpace(G4Event* event) {
+    const PhaseSpaceRecord record = fSimulationManager->GetPhaseSpaceReader()->Next();
+
+    G4ParticleDefinition* particle = G4ParticleTable::GetParticleTable()->FindParticle(record.fPDGCode);
+    if (particle == nullptr) {
+        particle = G4IonTable::GetIonTable()->GetIon(record.fPDGCode);
+    }
+    if (particle == nullptr) {
+        cout << "PrimaryGeneratorAction - ERROR: phase space particle with PDG code " << record.fPDGCode
+             << " not found!" << endl;
+        exit(1);
+    }
+
+    G4ThreeVector position = {record.fPosition[0], record.fPosition[1], record.fPosition[2]};
+    G4ThreeVector direction = {record.fDirection[0], record.fDirection[1], record.fDirection[2]};
+
+    if (fSimulationManager->GetPhaseSpaceRandomRotation()) {
+        // only valid if the inner geometry is symmetric around the rotation axis
+        const TVector3& axis = fSimulationManager->GetPhaseSpaceRotationAxis();
+        const G4ThreeVector rotationAxis = {axis.X(), axis.Y(), axis.Z()};
+        const double angle = 2 * M_PI * G4UniformRand();
+        position.rotate(angle, rotationAxis);
+        direction.rotate(angle, rotationAxis);
+    }
+
+    fParticleGun.SetParticleDefinition(particle);
+    fParticleGun.SetParticlePosition(position * mm);
+    fParticleGun.SetParticleMomentumDirection(direction);
+    fParticleGun.SetParticleEnergy(record.fEnergy * keV);
+    fParticleGun.SetParticleTime(record.fTime * microsecond);
+    fParticleGun.GeneratePrimaryVertex(event);
+
+    event->GetPrimaryVertex()->SetWeight(record.fWeight);
+}
+
+bool PrimaryGeneratorAction::GeneratePrimariesFromDecayLibrary(G4Event* event) {
+    const DecayFinalState* finalState = fDecayLibrary->Sample(fParticleGun.GetParticleDefinition());
+    if (finalState == nullptr) {
+        return false;
+    }
+
+    // the same final state can be sampled many times, a random rotation of the whole final state removes the
+    // correlation between events while keeping the angular correlations between the products
+    const G4ThreeVector axis = G4RandomDirection();
+    const double angle = 2 * M_PI * G4UniformRand();
+
+    // all products share the decay time, which is stored in the vertex. It is sampled for each event, as the
+    // process would do for the nucleus decaying at rest
+    const G4double decayTime =
+        -fParticleGun.GetParticleDefinition()->GetPDGLifeTime() * G4Log(1 - G4UniformRand());
+    auto vertex = new G4PrimaryVertex(fParticleGun.GetParticlePosition(),
+                                      fParticleGun.GetParticleTime() + decayTime + finalState->front().fTime);
+    for (const auto& product : *finalState) {
+        G4ThreeVector direction = product.fDirection;
+        direction.rotateZ(angle);
+        direction.rotateUz(axis);
+
+        auto primary = new G4PrimaryParticle(product.fParticle);
+        primary->SetMomentumDirection(direction);
+        primary->SetKineticEnergy(product.fEnergy);
+        if (product.fParticle->GetParticleType() == "nucleus") {
+            primary->SetCharge(product.fParticle->GetPDGCharge());
+            primary->SetUserInformation(new DecayLibraryDaughterInformation());
+        }
+        vertex->SetPrimary(primary);
+    }
+    event->AddPrimaryVertex(vertex);
+
+    return true;
+}
+
 G4ParticleDefinition* PrimaryGeneratorAction::SetParticleDefinition(Int_t particleSourceIndex,
                                                                     const TRestGeant4Particle& particle) {
     auto simulationManager = fSimulationManager;
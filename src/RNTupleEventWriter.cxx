@@ -0,0 +1,198 @@
+
+#include "RNTupleEventWriter.h"
+
+#ifdef RESTG4_WITH_RNTUPLE
+
+#include <ROOT/RNTupleModel.hxx>
+#include <ROOT/RNTupleWriteOptions.hxx>
+#include <TRestGeant4Event.h>
+
+#include "SimulationManager.h"
+
+using namespace std;
+using namespace RNTupleAPI;
+
+RNTupleEventWriter::RNTupleEventWriter(const string& filename, int compressionSettings,
+                                       unsigned int hitFields)
+    : fFilename(filename), fHitFields(hitFields) {
+    auto model = RNTupleModel::Create();
+
+    model->MakeField<int>("eventID");
+    model->MakeField<int>("subEventID");
+    model->MakeField<double>("sensitiveVolumeEnergy");
+    model->MakeField<vector<float>>("primaryPosition");
+    model->MakeField<vector<string>>("primaryParticleNames");
+    model->MakeField<vector<float>>("primaryEnergies");
+
+    model->MakeField<vector<string>>("energyInVolumeName");
+    model->MakeField<vector<string>>("energyInVolumeParticle");
+    model->MakeField<vector<string>>("energyInVolumeProcess");
+    model->MakeField<vector<double>>("energyInVolume");
+
+    model->MakeField<vector<int>>("trackID");
+    model->MakeField<vector<int>>("trackParentID");
+    model->MakeField<vector<string>>("trackParticleName");
+    model->MakeField<vector<string>>("trackCreatorProcess");
+    model->MakeField<vector<float>>("trackInitialKineticEnergy");
+    model->MakeField<vector<double>>("trackGlobalTime");
+
+    model->MakeField<vector<vector<float>>>("hitsX");
+    model->MakeField<vector<vector<float>>>("hitsY");
+    model->MakeField<vector<vector<float>>>("hitsZ");
+    model->MakeField<vector<vector<float>>>("hitsEnergy");
+    model->MakeField<vector<vector<double>>>("hitsTime");
+    model->MakeField<vector<vector<float>>>("hitsKineticEnergy");
+    model->MakeField<vector<vector<float>>>("hitsMomentumDirectionX");
+    model->MakeField<vector<vector<float>>>("hitsMomentumDirectionY");
+    model->MakeField<vector<vector<float>>>("hitsMomentumDirectionZ");
+    model->MakeField<vector<vector<int>>>("hitsVolumeID");
+    model->MakeField<vector<vector<int>>>("hitsProcessID");
+
+    RNTupleWriteOptions options;
+    options.SetCompression(compressionSettings);
+
+    fWriter = RNTupleParallelWriter::Recreate(std::move(model), "Events", filename, options);
+}
+
+RNTupleEventWriter::~RNTupleEventWriter() = default;
+
+unique_ptr<RNTupleEventWriter::FillContext> RNTupleEventWriter::CreateFillContext() {
+    return make_unique<FillContext>(fWriter->CreateFillContext(), fHitFields);
+}
+
+RNTupleEventWriter::FillContext::FillContext(shared_ptr<RNTupleFillContext> context, unsigned int hitFields)
+    : fContext(std::move(context)), fEntry(fContext->CreateEntry()), fHitFields(hitFields) {
+    fEventID = fEntry->GetPtr<int>("eventID");
+    fSubEventID = fEntry->GetPtr<int>("subEventID");
+    fSensitiveVolumeEnergy = fEntry->GetPtr<double>("sensitiveVolumeEnergy");
+    fPrimaryPosition = fEntry->GetPtr<vector<float>>("primaryPosition");
+    fPrimaryParticleNames = fEntry->GetPtr<vector<string>>("primaryParticleNames");
+    fPrimaryEnergies = fEntry->GetPtr<vector<float>>("primaryEnergies");
+
+    fEnergyInVolumeName = fEntry->GetPtr<vector<string>>("energyInVolumeName");
+    fEnergyInVolumeParticle = fEntry->GetPtr<vector<string>>("energyInVolumeParticle");
+    fEnergyInVolumeProcess = fEntry->GetPtr<vector<string>>("energyInVolumeProcess");
+    fEnergyInVolume = fEntry->GetPtr<vector<double>>("energyInVolume");
+
+    fTrackID = fEntry->GetPtr<vector<int>>("trackID");
+    fTrackParentID = fEntry->GetPtr<vector<int>>("trackParentID");
+    fTrackParticleName = fEntry->GetPtr<vector<string>>("trackParticleName");
+    fTrackCreatorProcess = fEntry->GetPtr<vector<string>>("trackCreatorProcess");
+    fTrackInitialKineticEnergy = fEntry->GetPtr<vector<float>>("trackInitialKineticEnergy");
+    fTrackGlobalTime = fEntry->GetPtr<vector<double>>("trackGlobalTime");
+
+    fHitsX = fEntry->GetPtr<vector<vector<float>>>("hitsX");
+    fHitsY = fEntry->GetPtr<vector<vector<float>>>("hitsY");
+    fHitsZ = fEntry->GetPtr<vector<vector<float>>>("hitsZ");
+    fHitsEnergy = fEntry->GetPtr<vector<vector<float>>>("hitsEnergy");
+    fHitsTime = fEntry->GetPtr<vector<vector<double>>>("hitsTime");
+    fHitsKineticEnergy = fEntry->GetPtr<vector<vector<float>>>("hitsKineticEnergy");
+    fHitsDirectionX = fEntry->GetPtr<vector<vector<float>>>("hitsMomentumDirectionX");
+    fHitsDirectionY = fEntry->GetPtr<vector<vector<float>>>("hitsMomentumDirectionY");
+    fHitsDirectionZ = fEntry->GetPtr<vector<vector<float>>>("hitsMomentumDirectionZ");
+    fHitsVolumeID = fEntry->GetPtr<vector<vector<int>>>("hitsVolumeID");
+    fHitsProcessID = fEntry->GetPtr<vector<vector<int>>>("hitsProcessID");
+}
+
+RNTupleEventWriter::FillContext::~FillContext() {
+    // remaining entries of this thread are written as a last cluster
+    fContext->FlushCluster();
+}
+
+void RNTupleEventWriter::FillContext::Fill(const TRestGeant4Event& event,
+                                           const VolumeEnergies& volumeEnergies) {
+    *fEventID = event.GetID();
+    *fSubEventID = event.GetSubID();
+    *fSensitiveVolumeEnergy = event.GetSensitiveVolumeEnergy();
+
+    const TVector3 origin = event.GetPrimaryEventOrigin();
+    *fPrimaryPosition = {float(origin.X()), float(origin.Y()), float(origin.Z())};
+    fPrimaryParticleNames->clear();
+    fPrimaryEnergies->clear();
+    for (int i = 0; i < int(event.GetNumberOfPrimaries()); i++) {
+        fPrimaryParticleNames->emplace_back(event.GetPrimaryEventParticleName(i).Data());
+        fPrimaryEnergies->push_back(event.GetPrimaryEventEnergy(i));
+    }
+
+    *fEnergyInVolumeName = volumeEnergies.fVolume;
+    *fEnergyInVolumeParticle = volumeEnergies.fParticle;
+    *fEnergyInVolumeProcess = volumeEnergies.fProcess;
+    *fEnergyInVolume = volumeEnergies.fEnergy;
+
+    const size_t numberOfTracks = event.GetNumberOfTracks();
+    for (auto column : {fTrackID, fTrackParentID}) {
+        column->resize(numberOfTracks);
+    }
+    for (auto column : {fTrackParticleName, fTrackCreatorProcess}) {
+        column->resize(numberOfTracks);
+    }
+    fTrackInitialKineticEnergy->resize(numberOfTracks);
+    fTrackGlobalTime->resize(numberOfTracks);
+    for (auto column : {fHitsX, fHitsY, fHitsZ, fHitsEnergy, fHitsKineticEnergy, fHitsDirectionX,
+                        fHitsDirectionY, fHitsDirectionZ}) {
+        column->resize(numberOfTracks);
+    }
+    fHitsTime->resize(numberOfTracks);
+    fHitsVolumeID->resize(numberOfTracks);
+    fHitsProcessID->resize(numberOfTracks);
+
+    for (size_t t = 0; t < numberOfTracks; t++) {
+        const auto& track = event.GetTrack(t);
+        (*fTrackID)[t] = track.GetTrackID();
+        (*fTrackParentID)[t] = track.GetParentID();
+        (*fTrackParticleName)[t] = track.GetParticleName().Data();
+        (*fTrackCreatorProcess)[t] = track.GetCreatorProcess().Data();
+        (*fTrackInitialKineticEnergy)[t] = track.GetInitialKineticEnergy();
+        (*fTrackGlobalTime)[t] = track.GetGlobalTime();
+
+        const auto& hits = track.GetHits();
+        const size_t numberOfHits = hits.GetNumberOfHits();
+        // inner vectors keep their capacity from previous events
+        auto& x = (*fHitsX)[t];
+        auto& y = (*fHitsY)[t];
+        auto& z = (*fHitsZ)[t];
+        auto& energy = (*fHitsEnergy)[t];
+        auto& time = (*fHitsTime)[t];
+        auto& kineticEnergy = (*fHitsKineticEnergy)[t];
+        auto& directionX = (*fHitsDirectionX)[t];
+        auto& directionY = (*fHitsDirectionY)[t];
+        auto& directionZ = (*fHitsDirectionZ)[t];
+        auto& volumeID = (*fHitsVolumeID)[t];
+        auto& processID = (*fHitsProcessID)[t];
+        x.resize(numberOfHits);
+        y.resize(numberOfHits);
+        z.resize(numberOfHits);
+        energy.resize(numberOfHits);
+        time.resize(numberOfHits);
+        const bool storeKineticEnergy = fHitFields & HitFields::KineticEnergy;
+        const bool storeDirection = fHitFields & HitFields::MomentumDirection;
+        kineticEnergy.resize(storeKineticEnergy ? numberOfHits : 0);
+        for (auto direction : {&directionX, &directionY, &directionZ}) {
+            direction->resize(storeDirection ? numberOfHits : 0);
+        }
+        volumeID.resize(numberOfHits);
+        processID.resize(numberOfHits);
+        for (size_t i = 0; i < numberOfHits; i++) {
+            x[i] = hits.GetX(i);
+            y[i] = hits.GetY(i);
+            z[i] = hits.GetZ(i);
+            energy[i] = hits.GetEnergy(i);
+            time[i] = hits.GetTime(i);
+            if (storeKineticEnergy) {
+                kineticEnergy[i] = hits.GetKineticEnergy(i);
+            }
+            if (storeDirection) {
+                const TVector3 direction = hits.GetMomentumDirection(i);
+                directionX[i] = direction.X();
+                directionY[i] = direction.Y();
+                directionZ[i] = direction.Z();
+            }
+            volumeID[i] = hits.GetVolumeId(i);
+            processID[i] = hits.GetProcess(i);
+        }
+    }
+
+    fContext->Fill(*fEntry);
+}
+
+#endif  // RESTG4_WITH_RNTUPLE
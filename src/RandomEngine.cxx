@@ -0,0 +1,110 @@
+
+#include "RandomEngine.h"
+
+#include <CLHEP/Random/MixMaxRng.h>
+#include <CLHEP/Random/RanecuEngine.h>
+#ifndef GEANT4_VERSION_LESS_11_0_0
+#include <CLHEP/Random/RanluxppEngine.h>
+#endif
+#include <Randomize.hh>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <set>
+
+using namespace std;
+
+namespace {
+mutex countingEnginesMutex;
+set<const CountingRandomEngine*> countingEngines;
+uint64_t countOfDeletedEngines = 0;
+}  // namespace
+
+namespace RandomEngine {
+
+string GetAvailableNames() {
+#ifndef GEANT4_VERSION_LESS_11_0_0
+    return "ranecu, mixmax, ranluxpp";
+#else
+    return "ranecu, mixmax";
+#endif
+}
+
+CLHEP::HepRandomEngine* Create(const string& name) {
+    if (name == "ranecu") {
+        return new CLHEP::RanecuEngine();
+    } else if (name == "mixmax") {
+        return new CLHEP::MixMaxRng();
+    }
+#ifndef GEANT4_VERSION_LESS_11_0_0
+    else if (name == "ranluxpp") {
+        return new CLHEP::RanluxppEngine();
+    }
+#endif
+    cerr << "Unknown random engine '" << name << "', available engines are: " << GetAvailableNames() << endl;
+    exit(1);
+}
+
+double Benchmark(const string& name, size_t count) {
+    unique_ptr<CLHEP::HepRandomEngine> engine(Create(name));
+    constexpr int blockSize = 1024;
+    double block[blockSize];
+    double sum = 0;
+
+    const auto start = chrono::steady_clock::now();
+    for (size_t drawn = 0; drawn < count; drawn += blockSize) {
+        for (double& value : block) {
+            value = engine->flat();  // same per call path as G4UniformRand
+        }
+        sum += block[0];
+    }
+    const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    volatile double sink = sum;  // keeps the compiler from removing the loop
+    (void)sink;
+    return elapsed.count() > 0 ? count / elapsed.count() : 0;
+}
+
+}  // namespace RandomEngine
+
+CountingRandomEngine::CountingRandomEngine(CLHEP::HepRandomEngine* engine) : fEngine(engine) {
+    lock_guard<mutex> guard(countingEnginesMutex);
+    countingEngines.insert(this);
+}
+
+CountingRandomEngine::~CountingRandomEngine() {
+    lock_guard<mutex> guard(countingEnginesMutex);
+    countingEngines.erase(this);
+    countOfDeletedEngines += fCount;
+}
+
+uint64_t CountingRandomEngine::GetTotalCount() {
+    lock_guard<mutex> guard(countingEnginesMutex);
+    uint64_t total = countOfDeletedEngines;
+    for (const auto engine : countingEngines) {
+        total += engine->fCount;
+    }
+    return total;
+}
+
+WorkerThreadInitialization::WorkerThreadInitialization(const string& engineName, bool countRandomNumbers)
+    : fEngineName(engineName), fCountRandomNumbers(countRandomNumbers) {}
+
+void WorkerThreadInitialization::SetupRNGEngine(const CLHEP::HepRandomEngine*) const {
+    // seeds are set by the master for each event
+    CLHEP::HepRandomEngine* engine = RandomEngine::Create(fEngineName);
+    if (fCountRandomNumbers) {
+        engine = new CountingRandomEngine(engine);
+    }
+    G4Random::setTheEngine(engine);
+}
+
+Double_t Geant4TRandom::Rndm() { return G4UniformRand(); }
+
+void Geant4TRandom::RndmArray(Int_t n, Float_t* array) {
+    for (Int_t i = 0; i < n; i++) {
+        array[i] = Float_t(G4UniformRand());
+    }
+}
+
+void Geant4TRandom::RndmArray(Int_t n, Double_t* array) { G4Random::getTheEngine()->flatArray(n, array); }
@@ -16,10 +16,11 @@ SensitiveDetector::SensitiveDetector(SimulationManager* simulationManager, const
 
 G4bool SensitiveDetector::ProcessHits(G4Step* step, G4TouchableHistory*) {
     // return value will always be ignored, its present for backwards compatibility (I guess)
-    const auto volumeName = fSimulationManager->GetRestMetadata()
-                                ->GetGeant4GeometryInfo()
-                                .GetAlternativeNameFromGeant4PhysicalName(
-                                    step->GetPreStepPoint()->GetPhysicalVolume()->GetName());
+    const auto& context = fSimulationManager->GetOutputManager()->GetContext();
+    if (context.fMaterialScan) {
+        return true;  // path lengths are recorded in the stepping action
+    }
+    const auto& volumeName = context.GetVolume(step->GetPreStepPoint()->GetPhysicalVolume()).fName;
 
     const bool isGeantino = step->GetTrack()->GetParticleDefinition() == G4Geantino::Definition();
 
@@ -27,7 +28,7 @@ G4bool SensitiveDetector::ProcessHits(G4Step* step, G4TouchableHistory*) {
         // Since geantinos don't deposit energy, the length traveled inside the volumes is stored as energy
         // (mm as keV)
         const auto length = step->GetStepLength() / CLHEP::mm;
-        fSimulationManager->GetOutputManager()->AddSensitiveEnergy(length, volumeName);
+        context.fOutputManager->AddSensitiveEnergy(length, volumeName);
         return true;
     } else {
         auto energy = step->GetTotalEnergyDeposit() / keV;
@@ -35,7 +36,7 @@ G4bool SensitiveDetector::ProcessHits(G4Step* step, G4TouchableHistory*) {
         if (energy <= 0) {
             return true;
         }
-        fSimulationManager->GetOutputManager()->AddSensitiveEnergy(energy, volumeName);
+        context.fOutputManager->AddSensitiveEnergy(energy, volumeName);
         return true;
     }
 }
\ No newline at end of file
@@ -1,10 +1,18 @@
 
 #include "SimulationManager.h"
 
+#include <TBranch.h>
+#include <TFile.h>
+#include <TNamed.h>
+
 #include <G4EventManager.hh>
+#include <G4Material.hh>
 #include <G4Nucleus.hh>
+#include <G4Step.hh>
 #include <G4Threading.hh>
+#include <G4VTouchable.hh>
 #include <Randomize.hh>
+#include <algorithm>
 
 #include "SteppingAction.h"
 
@@ -84,12 +92,27 @@ void SimulationManager::EndOfRunAction() {
         }
     }
 
+    size_t numberOfTriggers = 0;
+    size_t numberOfDeadTimeLosses = 0;
     for (auto& outputManager : fOutputManagerContainer) {
         fNumberOfProcessedEvents += outputManager->GetEventCounter();
+        numberOfTriggers += outputManager->GetNumberOfTriggers();
+        numberOfDeadTimeLosses += outputManager->GetNumberOfDeadTimeLosses();
+        outputManager->MergeTallies();
         delete outputManager;
     }
     GetRestMetadata()->SetNumberOfEvents(fNumberOfProcessedEvents);
 
+    if (fEventBuildingWindow > 0 && numberOfTriggers + numberOfDeadTimeLosses > 0) {
+        cout << "Event building: " << numberOfTriggers << " triggers, " << numberOfDeadTimeLosses
+             << " lost in dead time (live fraction "
+             << double(numberOfTriggers) / double(numberOfTriggers + numberOfDeadTimeLosses) << ")" << endl;
+    }
+
+    if (fPhaseSpaceWriter != nullptr) {
+        fPhaseSpaceWriter->Close(fNumberOfProcessedEvents);
+    }
+
     fOutputManagerContainer.clear();
 }
 
@@ -111,10 +134,17 @@ void SimulationManager::InsertEvent(std::unique_ptr<TRestGeant4Event>& event) {
 void SimulationManager::WriteEvents() {
     lock_guard<mutex> guard(fSimulationManagerMutex);
 
-    if (fEventContainer.empty()) {
+    if (fEventContainer.empty() && fVoxelEventContainer.empty() && fReadoutSignalEventContainer.empty()) {
         return;
     }
 
+    while (!fCompressedEventContainer.empty()) {
+        // already streamed and compressed by the workers, branches of this tree are not compressed again
+        fCompressedEvent = std::move(fCompressedEventContainer.front());
+        fCompressedEventTree->Fill();
+        fCompressedEventContainer.pop();
+    }
+
     while (!fEventContainer.empty()) {
         fEvent = *fEventContainer.front();
 
@@ -132,6 +162,22 @@ void SimulationManager::WriteEvents() {
         fEventContainer.pop();
     }
 
+    while (!fVoxelEventContainer.empty()) {
+        fVoxelEvent = std::move(fVoxelEventContainer.front());
+        if (fVoxelTree != nullptr) {
+            fVoxelTree->Fill();
+        }
+        fVoxelEventContainer.pop();
+    }
+
+    while (!fReadoutSignalEventContainer.empty()) {
+        fReadoutSignalEvent = std::move(fReadoutSignalEventContainer.front());
+        if (fReadoutSignalTree != nullptr) {
+            fReadoutSignalTree->Fill();
+        }
+        fReadoutSignalEventContainer.pop();
+    }
+
     const auto nRequestedEntries = GetRestMetadata()->GetNumberOfRequestedEntries();
     if (nRequestedEntries > 0 && !fAbortFlag && fRestRun->GetEventTree()->GetEntries() >= nRequestedEntries) {
         G4cout << "Stopping Run! We have reached the number of requested entries (" << nRequestedEntries
@@ -182,6 +228,519 @@ void SimulationManager::InitializeUserDistributions() {
     }
 }
 
+unsigned int HitFields::FromString(const string& fields) {
+    if (fields == "all") {
+        return All;
+    }
+    unsigned int result = 0;
+    for (const auto& field : Split(RemoveWhiteSpaces(fields), ",")) {
+        if (field == "time") {
+            result |= Time;
+        } else if (field == "kineticEnergy") {
+            result |= KineticEnergy;
+        } else if (field == "momentumDirection") {
+            result |= MomentumDirection;
+        } else if (field == "position" || field == "energy" || field == "processID" || field == "volumeID") {
+            // always stored
+        } else {
+            cerr << "HitFields::FromString - Unknown hit field '" << field
+                 << "'. Valid fields are: position, energy, processID, volumeID, time, kineticEnergy, "
+                    "momentumDirection"
+                 << endl;
+            exit(1);
+        }
+    }
+    return result;
+}
+
+string HitFields::ToString(unsigned int fields) {
+    string result = "position,energy,processID,volumeID";
+    if (fields & Time) {
+        result += ",time";
+    }
+    if (fields & KineticEnergy) {
+        result += ",kineticEnergy";
+    }
+    if (fields & MomentumDirection) {
+        result += ",momentumDirection";
+    }
+    return result;
+}
+
+void SimulationManager::InitializeHitStorageOptions() {
+    // Columns not selected are not computed and hold placeholders, which compress to almost nothing. Time
+    // cannot be dropped since it is part of 'TRestHits', it is zero for every hit when not selected
+    fHitFields = HitFields::FromString(fRestGeant4Metadata->GetParameter("hitFields", "all"));
+    if (fHitFields != HitFields::All) {
+        cout << "Storing hit fields: " << HitFields::ToString(fHitFields) << endl;
+    }
+
+    // Zero energy hits in active volumes are dropped at record time, except the first and last step of
+    // each track
+    fRemoveZeroEnergyHits = StringToBool(fRestGeant4Metadata->GetParameter("removeZeroEnergyHits", "false"));
+    if (fRemoveZeroEnergyHits && fRestGeant4Metadata->GetRemoveUnwantedTracks() &&
+        fRestGeant4Metadata->GetRemoveUnwantedTracksKeepZeroEnergyTracks()) {
+        RESTWarning << "'removeZeroEnergyHits' is enabled: zero energy tracks will only be kept if their "
+                       "first or last step is inside a keep volume"
+                    << RESTendl;
+    }
+}
+
+void SimulationManager::InitializeEventCompression() {
+    if (!StringToBool(fRestGeant4Metadata->GetParameter("compressEventsInWorkers", "false"))) {
+        return;
+    }
+
+    fCompressionSettings = fRestRun->GetOutputFile()->GetCompressionSettings();
+    cout << "Events will be streamed and compressed on the worker threads (compression settings "
+         << fCompressionSettings << "). Tracks are stored in 'CompressedEventTree', 'EventTree' only keeps "
+         << "the event summary" << endl;
+
+    // Created in the current directory, which should be the output file
+    fCompressedEventTree = new TTree("CompressedEventTree", "Compressed TRestGeant4Event buffers");
+    fCompressedEventTree->Branch("eventID", &fCompressedEvent.fEventID);
+    fCompressedEventTree->Branch("subEventID", &fCompressedEvent.fSubEventID);
+    fCompressedEventTree->Branch("uncompressedSize", &fCompressedEvent.fUncompressedSize);
+    fCompressedEventTree->Branch("buffer", &fCompressedEvent.fBuffer);
+    for (const auto& branch : *fCompressedEventTree->GetListOfBranches()) {
+        ((TBranch*)branch)->SetCompressionSettings(0);
+    }
+}
+
+void SimulationManager::InsertCompressedEvent(std::unique_ptr<TRestGeant4Event>& event,
+                                              CompressedEvent& compressedEvent) {
+    lock_guard<mutex> guard(fSimulationManagerMutex);
+    fCompressedEventContainer.push(std::move(compressedEvent));
+    fEventContainer.push(std::move(event));
+}
+
+void SimulationManager::InitializeRNTupleOutput() {
+    const string filename = fRestGeant4Metadata->GetParameter("rntupleOutputFile", "");
+    if (filename.empty()) {
+        return;
+    }
+#ifdef RESTG4_WITH_RNTUPLE
+    if (GetCompressEventsInWorkers()) {
+        cerr << "'rntupleOutputFile' and 'compressEventsInWorkers' cannot be used at the same time" << endl;
+        exit(1);
+    }
+    fRNTupleWriter = make_unique<RNTupleEventWriter>(
+        filename, fRestRun->GetOutputFile()->GetCompressionSettings(), fHitFields);
+    cout << "Events will be written to RNTuple 'Events' in '" << filename
+         << "', 'EventTree' only keeps the event summary" << endl;
+#else
+    cerr << "'rntupleOutputFile' requires restG4 to be built against ROOT 6.32 or newer with RNTuple support"
+         << endl;
+    exit(1);
+#endif
+}
+
+#ifdef RESTG4_WITH_RNTUPLE
+void SimulationManager::CloseRNTupleOutput() {
+    // fill contexts are owned by the output managers, which are deleted at the end of the run
+    const string filename = fRNTupleWriter->GetFilename();
+    fRNTupleWriter.reset();
+    cout << "RNTuple output written to '" << filename << "'" << endl;
+}
+#endif
+
+void SimulationManager::InitializeVoxelization() {
+    if (!StringToBool(fRestGeant4Metadata->GetParameter("voxelization", "false"))) {
+        return;
+    }
+
+    const TVector3 voxelSize = fRestGeant4Metadata->Get3DVectorParameterWithUnits("voxelSize");
+    const TVector3 voxelOrigin =
+        fRestGeant4Metadata->Get3DVectorParameterWithUnits("voxelOrigin", TVector3(0, 0, 0));
+    const TVector3 voxelRotation =
+        StringTo3DVector(fRestGeant4Metadata->GetParameter("voxelRotation", "(0,0,0)"));
+
+    fVoxelizer = make_unique<HitVoxelizer>(voxelSize, voxelOrigin, voxelRotation);
+    cout << "Voxelization of hits enabled: " << fVoxelizer->ToString() << endl;
+
+    // Created in the current directory, which should be the output file
+    fVoxelTree = new TTree("VoxelTree", fVoxelizer->ToString().c_str());
+    fVoxelTree->Branch("eventID", &fVoxelEvent.fEventID);
+    fVoxelTree->Branch("subEventID", &fVoxelEvent.fSubEventID);
+    fVoxelTree->Branch("voxelX", &fVoxelEvent.fX);
+    fVoxelTree->Branch("voxelY", &fVoxelEvent.fY);
+    fVoxelTree->Branch("voxelZ", &fVoxelEvent.fZ);
+    fVoxelTree->Branch("voxelEnergy", &fVoxelEvent.fEnergy);
+}
+
+void SimulationManager::InsertVoxelEvent(VoxelEvent& voxelEvent) {
+    lock_guard<mutex> guard(fSimulationManagerMutex);
+    fVoxelEventContainer.push(std::move(voxelEvent));
+}
+
+void SimulationManager::InitializeElectronDrift() {
+    if (!StringToBool(fRestGeant4Metadata->GetParameter("electronDrift", "false"))) {
+        return;
+    }
+    if (fVoxelizer != nullptr) {
+        cerr << "'electronDrift' and 'voxelization' cannot be enabled at the same time" << endl;
+        exit(1);
+    }
+
+    const auto metadata = fRestGeant4Metadata;
+
+    ElectronDrift::Parameters parameters;
+    parameters.fVolume = metadata->GetParameter("driftVolume", metadata->GetSensitiveVolume());
+    parameters.fPlanePosition =
+        metadata->Get3DVectorParameterWithUnits("readoutPlanePosition", TVector3(0, 0, 0));
+    parameters.fPlaneNormal = StringTo3DVector(metadata->GetParameter("readoutPlaneNormal", "(0,0,1)"));
+    parameters.fDriftVelocity = StringToDouble(metadata->GetParameter("driftVelocity"));  // mm/us
+    parameters.fLongitudinalDiffusion = StringToDouble(metadata->GetParameter("longitudinalDiffusion", "0"));
+    parameters.fTransverseDiffusion = StringToDouble(metadata->GetParameter("transverseDiffusion", "0"));
+    parameters.fAttachment = StringToDouble(metadata->GetParameter("attachment", "0"));
+    parameters.fWValue = StringToDouble(metadata->GetParameter("wValue", "26"));  // eV
+    parameters.fPitch = metadata->GetDblParameterWithUnits("readoutPitch", 1);
+    parameters.fSamplingTime = StringToDouble(metadata->GetParameter("samplingTime", "1"));  // us
+
+    fElectronDrift = make_unique<ElectronDrift>(parameters);
+    cout << "Electron drift of hits enabled: " << fElectronDrift->ToString() << endl;
+
+    if (!(fHitFields & HitFields::Time)) {
+        RESTWarning << "'electronDrift' is enabled but hit time is not stored, all hits are assumed to "
+                       "happen at t = 0"
+                    << RESTendl;
+    }
+
+    // Created in the current directory, which should be the output file
+    fReadoutSignalTree = new TTree("ReadoutSignalTree", fElectronDrift->ToString().c_str());
+    fReadoutSignalTree->Branch("eventID", &fReadoutSignalEvent.fEventID);
+    fReadoutSignalTree->Branch("subEventID", &fReadoutSignalEvent.fSubEventID);
+    fReadoutSignalTree->Branch("channelX", &fReadoutSignalEvent.fChannelX);
+    fReadoutSignalTree->Branch("channelY", &fReadoutSignalEvent.fChannelY);
+    fReadoutSignalTree->Branch("timeBin", &fReadoutSignalEvent.fTimeBin);
+    fReadoutSignalTree->Branch("charge", &fReadoutSignalEvent.fCharge);
+}
+
+void SimulationManager::InsertReadoutSignalEvent(ReadoutSignalEvent& signalEvent) {
+    lock_guard<mutex> guard(fSimulationManagerMutex);
+    fReadoutSignalEventContainer.push(std::move(signalEvent));
+}
+
+void SimulationManager::InitializePhaseSpace() {
+    const auto metadata = fRestGeant4Metadata;
+
+    // Recording: particles entering 'phaseSpaceVolume' are written to 'phaseSpaceFile'
+    const string volume = metadata->GetParameter("phaseSpaceVolume", "");
+    if (!volume.empty()) {
+        const string filename = metadata->GetParameter("phaseSpaceFile", "");
+        if (filename.empty()) {
+            cerr << "'phaseSpaceVolume' is defined but 'phaseSpaceFile' is not" << endl;
+            exit(1);
+        }
+        fPhaseSpaceVolume = volume;
+        // by default particles are killed after being recorded, the next stage takes it from there
+        fPhaseSpaceKill = StringToBool(metadata->GetParameter("phaseSpaceKill", "true"));
+        fPhaseSpaceWriter = make_unique<PhaseSpaceWriter>(filename);
+        cout << "Recording particles entering volume '" << fPhaseSpaceVolume << "' into phase space file '"
+             << filename << "'" << endl;
+    }
+
+    // Restart: primaries are taken from 'phaseSpaceInputFile' instead of the generator sources
+    const string inputFilename = metadata->GetParameter("phaseSpaceInputFile", "");
+    if (!inputFilename.empty()) {
+        const int recycling = StringToInteger(metadata->GetParameter("phaseSpaceRecycling", "1"));
+        fPhaseSpaceReader = make_unique<PhaseSpaceReader>(inputFilename, recycling);
+        fPhaseSpaceRandomRotation = StringToBool(metadata->GetParameter("phaseSpaceRandomRotation", "false"));
+        fPhaseSpaceRotationAxis =
+            StringTo3DVector(metadata->GetParameter("phaseSpaceRotationAxis", "(0,0,1)"));
+    }
+}
+
+void SimulationManager::InitializeEventOverlay() {
+    const auto metadata = fRestGeant4Metadata;
+
+    const string libraryFilename = metadata->GetParameter("overlayLibrary", "");
+    if (libraryFilename.empty()) {
+        return;
+    }
+
+    const double rate = StringToDouble(metadata->GetParameter("overlayRate"));                  // Hz
+    fOverlayTimeWindow = StringToDouble(metadata->GetParameter("overlayTimeWindow"));           // us
+    fOverlayTranslation = metadata->Get3DVectorParameterWithUnits("overlayTranslation", TVector3(0, 0, 0));
+    if (rate <= 0 || fOverlayTimeWindow <= 0) {
+        cerr << "'overlayRate' (Hz) and 'overlayTimeWindow' (us) must be positive to use 'overlayLibrary'"
+             << endl;
+        exit(1);
+    }
+    fOverlayMeanNumberOfEvents = rate * fOverlayTimeWindow * 1E-6;
+
+    TRestRun libraryRun(libraryFilename);
+    auto libraryEvent = libraryRun.GetInputEvent<TRestGeant4Event>();
+    if (libraryEvent == nullptr || libraryRun.GetEntries() <= 0) {
+        cerr << "Overlay library '" << libraryFilename << "' does not contain any 'TRestGeant4Event'" << endl;
+        exit(1);
+    }
+    // files written before the hit fields were selectable store all of them
+    const auto libraryHitFieldsObject = libraryRun.GetInputFile()->Get<TNamed>(HitFields::ObjectName);
+    const unsigned int libraryHitFields =
+        libraryHitFieldsObject != nullptr ? HitFields::FromString(libraryHitFieldsObject->GetTitle())
+                                          : HitFields::All;
+    if ((fHitFields & libraryHitFields) != fHitFields) {
+        cerr << "Overlay library '" << libraryFilename << "' only stores the hit fields '"
+             << HitFields::ToString(libraryHitFields) << "' but '" << HitFields::ToString(fHitFields)
+             << "' are requested in 'hitFields'" << endl;
+        exit(1);
+    }
+    fOverlayLibrary.reserve(libraryRun.GetEntries());
+    for (int i = 0; i < libraryRun.GetEntries(); i++) {
+        libraryRun.GetEntry(i);
+        fOverlayLibrary.push_back(*libraryEvent);
+    }
+
+    cout << "Overlaying events from library '" << libraryFilename << "' (" << fOverlayLibrary.size()
+         << " events) with a mean of " << fOverlayMeanNumberOfEvents << " events per "
+         << fOverlayTimeWindow << " us window" << endl;
+}
+
+void SimulationManager::InitializeDecayLibrary() {
+    const auto metadata = fRestGeant4Metadata;
+
+    const int size = StringToInteger(metadata->GetParameter("decayLibrarySize", "0"));
+    if (size < 0) {
+        cerr << "'decayLibrarySize' must be >= 0" << endl;
+        exit(1);
+    }
+    fDecayLibrarySize = size;
+    if (fDecayLibrarySize == 0) {
+        return;
+    }
+    if (fPhaseSpaceReader != nullptr) {
+        RESTWarning << "'decayLibrarySize' has no effect when primaries are read from 'phaseSpaceInputFile'"
+                    << RESTendl;
+    }
+    cout << "Radioactive sources at rest will be sampled from a library of " << fDecayLibrarySize
+         << " decays per isotope" << endl;
+}
+
+void SimulationManager::InitializeMaterialScan() {
+    const auto metadata = fRestGeant4Metadata;
+
+    const string mode = metadata->GetParameter("materialScan", "");
+    if (mode.empty() || mode == "false") {
+        return;
+    }
+
+    MaterialScan::Parameters parameters;
+    if (mode == "point") {
+        parameters.fMode = MaterialScan::Mode::Point;
+    } else if (mode == "plane") {
+        parameters.fMode = MaterialScan::Mode::Plane;
+        if (metadata->GetParameter("materialScanRangeX", "").empty() ||
+            metadata->GetParameter("materialScanRangeY", "").empty()) {
+            cerr << "'materialScanRangeX' and 'materialScanRangeY' (mm) are required by 'plane' material scan"
+                 << endl;
+            exit(1);
+        }
+    } else {
+        cerr << "'materialScan' must be 'point' or 'plane', got '" << mode << "'" << endl;
+        exit(1);
+    }
+
+    parameters.fOrigin = metadata->Get3DVectorParameterWithUnits("materialScanOrigin", TVector3(0, 0, 0));
+    parameters.fDirection = StringTo3DVector(metadata->GetParameter("materialScanDirection", "(0,0,1)"));
+    const TVector2 bins = StringTo2DVector(metadata->GetParameter("materialScanBins", "(90,180)"));
+    parameters.fBinsX = Int_t(bins.X());
+    parameters.fBinsY = Int_t(bins.Y());
+    parameters.fRangeX = StringTo2DVector(metadata->GetParameter("materialScanRangeX", "(0,180)"));
+    parameters.fRangeY = StringTo2DVector(metadata->GetParameter("materialScanRangeY", "(0,360)"));
+
+    fMaterialScan = make_unique<MaterialScan>(parameters);
+
+    // one event per ray, the ray is chosen from the event ID
+    metadata->SetNumberOfEvents(fMaterialScan->GetNumberOfRays());
+    cout << "Material scan enabled with " << fMaterialScan->GetNumberOfRays()
+         << " rays, generator sources are ignored and no events will be stored: " << fMaterialScan->ToString()
+         << endl;
+}
+
+void SimulationManager::InitializeFastSimulation() {
+    const auto metadata = fRestGeant4Metadata;
+
+    const string regions = RemoveWhiteSpaces(metadata->GetParameter("fastSimulationRegions", ""));
+    if (regions.empty()) {
+        return;
+    }
+    fFastSimulationRegions = Split(regions, ",");
+
+    fFastSimulationEnergyThreshold = metadata->GetDblParameterWithUnits("fastSimulationEnergyThreshold", 0);
+    if (fFastSimulationEnergyThreshold <= 0) {
+        cerr << "'fastSimulationEnergyThreshold' must be positive when 'fastSimulationRegions' is set"
+             << endl;
+        exit(1);
+    }
+
+    // gammas have a much longer reach than electrons of the same energy, they get their own threshold
+    fFastSimulationGammaEnergyThreshold = metadata->GetDblParameterWithUnits(
+        "fastSimulationGammaEnergyThreshold", fFastSimulationEnergyThreshold);
+    if (fFastSimulationGammaEnergyThreshold < 0) {
+        cerr << "'fastSimulationGammaEnergyThreshold' cannot be negative" << endl;
+        exit(1);
+    }
+
+    cout << "Fast simulation enabled in regions '" << regions << "': e- and e+ below "
+         << fFastSimulationEnergyThreshold << " keV and gammas below " << fFastSimulationGammaEnergyThreshold
+         << " keV that cannot leave the region deposit their energy locally" << endl;
+}
+
+void SimulationManager::InitializePilot(const string& importanceMapFilename) {
+    if (importanceMapFilename.empty()) {
+        return;
+    }
+    const auto metadata = fRestGeant4Metadata;
+
+    const TVector3 bins = StringTo3DVector(metadata->GetParameter("pilotMeshBins", "(20,20,20)"));
+    const TVector3 minimum = metadata->Get3DVectorParameterWithUnits("pilotMeshMinimum", TVector3(0, 0, 0));
+    const TVector3 maximum = metadata->Get3DVectorParameterWithUnits("pilotMeshMaximum", TVector3(0, 0, 0));
+    const bool boundsSet = !metadata->GetParameter("pilotMeshMinimum", "").empty() ||
+                           !metadata->GetParameter("pilotMeshMaximum", "").empty();
+    if (boundsSet &&
+        (maximum.X() <= minimum.X() || maximum.Y() <= minimum.Y() || maximum.Z() <= minimum.Z())) {
+        cerr << "SimulationManager::InitializePilot - 'pilotMeshMaximum' must be larger than "
+                "'pilotMeshMinimum' in all three dimensions"
+             << endl;
+        exit(1);
+    }
+
+    fImportanceMap = make_unique<ImportanceMap>(bins, minimum, maximum);
+    fImportanceMapFilename = importanceMapFilename;
+
+    cout << "Pilot run enabled, importance map will be written to '" << fImportanceMapFilename
+         << "': " << fImportanceMap->ToString() << (fImportanceMap->HasBounds() ? "" : " (world bounds)")
+         << endl;
+}
+
+void SimulationManager::InitializeMeshTallies() {
+    const auto metadata = fRestGeant4Metadata;
+
+    const string names = RemoveWhiteSpaces(metadata->GetParameter("meshTallies", ""));
+    if (names.empty()) {
+        return;
+    }
+
+    for (const auto& name : Split(names, ",")) {
+        MeshTally::Parameters parameters;
+        parameters.fName = name;
+        if (metadata->GetParameter(name + "MeshMinimum", "").empty() ||
+            metadata->GetParameter(name + "MeshMaximum", "").empty()) {
+            cerr << "'" << name << "MeshMinimum' and '" << name << "MeshMaximum' are required by mesh tally '"
+                 << name << "'" << endl;
+            exit(1);
+        }
+        parameters.fMinimum = metadata->Get3DVectorParameterWithUnits(name + "MeshMinimum");
+        parameters.fMaximum = metadata->Get3DVectorParameterWithUnits(name + "MeshMaximum");
+        const TVector3 bins = StringTo3DVector(metadata->GetParameter(name + "MeshBins", "(10,10,10)"));
+        parameters.fBins[0] = Int_t(bins.X());
+        parameters.fBins[1] = Int_t(bins.Y());
+        parameters.fBins[2] = Int_t(bins.Z());
+        const string particles = RemoveWhiteSpaces(metadata->GetParameter(name + "MeshTrackLength", ""));
+        if (!particles.empty()) {
+            parameters.fTrackLengthParticles = Split(particles, ",");
+        }
+
+        fMeshTallies.push_back(make_unique<MeshTally>(parameters));
+        cout << "Mesh tally enabled: " << fMeshTallies.back()->ToString() << endl;
+    }
+}
+
+void SimulationManager::InitializeSurfaceTallies() {
+    const auto metadata = fRestGeant4Metadata;
+
+    const string volumes = RemoveWhiteSpaces(metadata->GetParameter("surfaceTallies", ""));
+    if (volumes.empty()) {
+        return;
+    }
+
+    for (const auto& volume : Split(volumes, ",")) {
+        SurfaceTally::Parameters parameters;
+        parameters.fVolume = volume;
+        parameters.fEnergyBins = StringToInteger(metadata->GetParameter(volume + "SurfaceEnergyBins", "100"));
+        parameters.fEnergyRange =
+            StringTo2DVector(metadata->GetParameter(volume + "SurfaceEnergyRange", "(0,10000)"));
+        parameters.fLogEnergy = StringToBool(metadata->GetParameter(volume + "SurfaceLogEnergy", "false"));
+        parameters.fAngleBins = StringToInteger(metadata->GetParameter(volume + "SurfaceAngleBins", "20"));
+
+        fSurfaceTallies.push_back(make_unique<SurfaceTally>(parameters));
+        cout << "Surface tally enabled: " << fSurfaceTallies.back()->ToString() << endl;
+    }
+}
+
+void SimulationManager::InitializeActivationTally() {
+    if (!StringToBool(fRestGeant4Metadata->GetParameter("activationTally", "false"))) {
+        return;
+    }
+    fActivationTally = make_unique<ActivationTally>();
+    cout << "Activation tally enabled" << endl;
+}
+
+void SimulationManager::InitializeEventBuilding() {
+    const auto metadata = fRestGeant4Metadata;
+
+    fEventBuildingWindow = StringToDouble(metadata->GetParameter("eventBuildingWindow", "0"));      // us
+    fEventBuildingDeadTime = StringToDouble(metadata->GetParameter("eventBuildingDeadTime", "0"));  // us
+    if (fEventBuildingWindow <= 0) {
+        if (fEventBuildingDeadTime > 0) {
+            cerr << "'eventBuildingDeadTime' requires a positive 'eventBuildingWindow' (us)" << endl;
+            exit(1);
+        }
+        fEventBuildingWindow = 0;
+        return;
+    }
+    if (fEventBuildingDeadTime < 0) {
+        cerr << "'eventBuildingDeadTime' (us) cannot be negative" << endl;
+        exit(1);
+    }
+    if (fVoxelizer != nullptr) {
+        // voxelized events no longer have the hits needed to merge sub-events
+        cerr << "'eventBuildingWindow' cannot be used together with 'voxelization'" << endl;
+        exit(1);
+    }
+    if (!(fHitFields & HitFields::Time)) {
+        // without it every hit is at t = 0 and all the sub-events would fall in the first window
+        cerr << "'eventBuildingWindow' requires the 'time' hit field, add it to 'hitFields'" << endl;
+        exit(1);
+    }
+
+    cout << "Sub-events are grouped in " << fEventBuildingWindow << " us windows with a dead time of "
+         << fEventBuildingDeadTime << " us" << endl;
+}
+
+void SimulationManager::WriteAuxiliaryOutput() {
+    if (fVoxelTree != nullptr) {
+        fVoxelTree->Write(nullptr, TObject::kOverwrite);
+    }
+    if (fReadoutSignalTree != nullptr) {
+        fReadoutSignalTree->Write(nullptr, TObject::kOverwrite);
+    }
+    if (fCompressedEventTree != nullptr) {
+        fCompressedEventTree->Write(nullptr, TObject::kOverwrite);
+    }
+#ifdef RESTG4_WITH_RNTUPLE
+    if (fRNTupleWriter != nullptr) {
+        CloseRNTupleOutput();
+    }
+#endif
+    if (fMaterialScan != nullptr) {
+        fMaterialScan->Write();
+    }
+    if (fImportanceMap != nullptr) {
+        fImportanceMap->Write(fImportanceMapFilename);
+    }
+    for (const auto& meshTally : fMeshTallies) {
+        meshTally->Write();
+    }
+    for (const auto& surfaceTally : fSurfaceTallies) {
+        surfaceTally->Write();
+    }
+    if (fActivationTally != nullptr) {
+        fActivationTally->Write();
+    }
+}
+
 void SimulationManager::StopSimulation() {
     // Still needs to be propagated to other threads, this is done in the BeginOfEventAction
     G4RunManager::GetRunManager()->AbortRun(true);
@@ -206,24 +765,41 @@ OutputManager::OutputManager(const SimulationManager* simulationManager)
         G4cout << "Error in 'OutputManager', this instance should never exist" << endl;
         exit(1);
     }
+
+    if (fSimulationManager->GetVoxelizer() != nullptr) {
+        fVoxelizer = make_unique<HitVoxelizer>(*fSimulationManager->GetVoxelizer());
+    }
+    if (fSimulationManager->GetElectronDrift() != nullptr) {
+        fElectronDrift = make_unique<ElectronDrift>(*fSimulationManager->GetElectronDrift());
+    }
+    for (const auto& meshTally : fSimulationManager->GetMeshTallies()) {
+        fMeshTallyGrids.emplace_back(*meshTally);
+    }
+    for (const auto& surfaceTally : fSimulationManager->GetSurfaceTallies()) {
+        fSurfaceTallySpectra.emplace_back(*surfaceTally);
+    }
 }
 
 void OutputManager::BeginOfEventAction() {
+    if (fContext == nullptr) {
+        // geometry is guaranteed to be constructed by the first event of the thread
+        fContext = make_unique<const ThreadContext>(fSimulationManager, this);
+    }
+
     // This should only be executed once at BeginOfEventAction
-    UpdateEvent();
+    if (!fContext->fMaterialScan) {
+        UpdateEvent();
+    }
     fProcessedEventsCounter++;
 
     if (fSimulationManager->GetAbortFlag()) {
         G4RunManager::GetRunManager()->AbortRun(true);
     }
 
-    if (fSimulationManager->GetRestMetadata()->GetSimulationMaxTimeSeconds() != 0 &&
-        !fSimulationManager->GetAbortFlag() &&
-        fSimulationManager->GetElapsedTime() >
-            fSimulationManager->GetRestMetadata()->GetSimulationMaxTimeSeconds()) {
+    if (fContext->fSimulationMaxTimeSeconds != 0 && !fSimulationManager->GetAbortFlag() &&
+        fSimulationManager->GetElapsedTime() > fContext->fSimulationMaxTimeSeconds) {
         G4cout << "Stopping Run! We have reached the time limit of "
-               << ToTimeStringLong(fSimulationManager->GetRestMetadata()->GetSimulationMaxTimeSeconds())
-               << endl;
+               << ToTimeStringLong(fContext->fSimulationMaxTimeSeconds) << endl;
         fSimulationManager->StopSimulation();
     }
 }
@@ -232,6 +808,17 @@ void OutputManager::UpdateEvent() {
     auto event = G4EventManager::GetEventManager()->GetConstCurrentEvent();
     fEvent = make_unique<TRestGeant4Event>(event);
     fEvent->InitializeReferences(fSimulationManager->GetRestRun());
+    fEvent->fTracks.reserve(GetExpectedNumberOfTracks());
+
+    if (fVoxelizer) {
+        fVoxelizer->Clear();
+    }
+
+    fTrackLineages.clear();
+    fReleasedTrackIDs.clear();
+    fReleasedSteps = 0;
+    fVolumeEnergies.clear();
+    fPhaseSpaceTrackIDs.clear();
 }
 
 bool OutputManager::IsEmptyEvent() const { return !fEvent || fEvent->fTracks.empty(); }
@@ -240,36 +827,132 @@ bool OutputManager::IsValidEvent() const {
     if (IsEmptyEvent()) {
         return false;
     }
-    if (fSimulationManager->GetRestMetadata()->GetSaveAllEvents()) {
+    if (fContext->fSaveAllEvents) {
         return true;
     }
     const auto energy = fEvent->GetSensitiveVolumeEnergy();
     if (energy <= 0) {
         return false;
     }
-    if (energy < fSimulationManager->GetRestMetadata()->GetMinimumEnergyStored() ||
-        energy > fSimulationManager->GetRestMetadata()->GetMaximumEnergyStored()) {
+    if (energy < fContext->fMinimumEnergyStored || energy > fContext->fMaximumEnergyStored) {
         return false;
     }
     return true;
 }
 
 void OutputManager::FinishAndSubmitEvent() {
+    if (fContext->fMaterialScan) {
+        SubmitMaterialScanRay();
+        return;
+    }
+
+    if (fContext->fPilot) {
+        SubmitPilotEvent();
+    }
+
+    if (!fPhaseSpaceRecords.empty()) {
+        // phase space is recorded regardless of the event being stored
+        fSimulationManager->GetPhaseSpaceWriter()->Write(fPhaseSpaceRecords);
+        fPhaseSpaceRecords.clear();
+    }
+
+    if (!fReleasedTrackIDs.empty()) {
+        CompactReleasedTracks();
+    }
+    BuildHits();
+    AddVolumeEnergies();
+    UpdateTracksPerEventStatistics(fEvent->fTracks.size());
+
+    if (fSimulationManager->GetEventBuildingWindow() > 0) {
+        // sub-events are not time ordered, they are grouped once the Geant4 event is done
+        fPendingSubEvents.push_back(std::move(fEvent));
+    } else {
+        SubmitEvent();
+    }
+    UpdateEvent();
+}
+
+void OutputManager::SubmitEvent() {
+    if (!fSimulationManager->GetOverlayLibrary().empty()) {
+        OverlayLibraryEvents();
+    }
+
     if (IsValidEvent()) {
-        if (fSimulationManager->GetRestMetadata()->GetRemoveUnwantedTracks()) {
+        if (fElectronDrift) {
+            // drift uses the hits of all tracks, so it goes before track removal
+            auto signalEvent =
+                fElectronDrift->Process(fEvent->GetID(), fEvent->GetSubID(), fEvent->fTracks,
+                                        fSimulationManager->GetRestMetadata()->GetGeant4GeometryInfo());
+            fSimulationManager->InsertReadoutSignalEvent(signalEvent);
+        }
+        if (fContext->fRemoveUnwantedTracks) {
             RemoveUnwantedTracks();
         }
-        fSimulationManager->InsertEvent(fEvent);
+        if (fElectronDrift) {
+            // readout signals are stored instead of the hits
+            for (auto& track : fEvent->fTracks) {
+                TRestGeant4Hits emptyHits;
+                emptyHits.SetEvent(fEvent.get());
+                track.SetHits(emptyHits);
+            }
+        }
+        if (fVoxelizer) {
+            auto voxelEvent = fVoxelizer->GetVoxelEvent(fEvent->GetID(), fEvent->GetSubID());
+            fSimulationManager->InsertVoxelEvent(voxelEvent);
+        }
+#ifdef RESTG4_WITH_RNTUPLE
+        if (fSimulationManager->GetRNTupleWriter() != nullptr) {
+            if (!fRNTupleFillContext) {
+                fRNTupleFillContext = fSimulationManager->GetRNTupleWriter()->CreateFillContext();
+            }
+            // flattened here, the output manager has access to the energy map of the event
+            RNTupleEventWriter::VolumeEnergies volumeEnergies;
+            for (const auto& [volumeName, particles] : fEvent->fEnergyInVolumePerParticlePerProcess) {
+                for (const auto& [particleName, processes] : particles) {
+                    for (const auto& [processName, energy] : processes) {
+                        volumeEnergies.fVolume.emplace_back(volumeName);
+                        volumeEnergies.fParticle.emplace_back(particleName);
+                        volumeEnergies.fProcess.emplace_back(processName);
+                        volumeEnergies.fEnergy.push_back(energy);
+                    }
+                }
+            }
+            fRNTupleFillContext->Fill(*fEvent, volumeEnergies);
+            // tracks are only stored in the RNTuple
+            fEvent->fTracks.clear();
+            fEvent->fTrackIDToTrackIndex.clear();
+        }
+#endif
+        if (fSimulationManager->GetCompressEventsInWorkers()) {
+            auto compressedEvent =
+                EventCompression::Compress(*fEvent, fSimulationManager->GetCompressionSettings());
+            // only the summary goes through the writer, tracks are in the compressed buffer
+            fEvent->fTracks.clear();
+            fEvent->fTrackIDToTrackIndex.clear();
+            fSimulationManager->InsertCompressedEvent(fEvent, compressedEvent);
+        } else {
+            fSimulationManager->InsertEvent(fEvent);
+        }
         fSimulationManager->WriteEvents();
     }
-    UpdateEvent();
 }
 
 void OutputManager::RecordTrack(const G4Track* track) {
     if (!IsValidTrack(track)) {
         return;
     }
+    if (fStepBuffer.Size() == 0 || fStepBuffer.fTrackID.back() != track->GetTrackID()) {
+        cout << "Initial step of the track has not been recorded! Problem with stepping verbose" << endl;
+        exit(1);
+    }
+    // registered so the track particle and creator process can also be resolved from the physics info tables
+    GetParticleID(track->GetParticleDefinition());
+    if (track->GetCreatorProcess() != nullptr) {
+        GetProcessID(track->GetCreatorProcess());
+    }
     fEvent->InsertTrack(track);
+    // the initial step is already buffered, it is the last one
+    fCurrentTrackFirstStep = fStepBuffer.Size() - 1;
 
     if (fEvent->fSubEventID > 0) {
         const auto& lastTrack = fEvent->fTracks.back();
@@ -296,7 +979,170 @@ void OutputManager::UpdateTrack(const G4Track* track) {
     fEvent->UpdateTrack(track);
 }
 
-void OutputManager::RecordStep(const G4Step* step) { fEvent->InsertStep(step); }
+void OutputManager::RecordStep(const G4Step* step) { BufferStep(step); }
+
+void OutputManager::RecordPhaseSpace(const G4Step* step) {
+    if (!fPhaseSpaceTrackIDs.insert(step->GetTrack()->GetTrackID()).second) {
+        // tracks that are not killed can come back, only their first entry is part of the phase space
+        return;
+    }
+    const G4StepPoint* point = step->GetPostStepPoint();
+    const G4ThreeVector& position = point->GetPosition();
+    const G4ThreeVector& direction = point->GetMomentumDirection();
+
+    PhaseSpaceRecord record;
+    record.fPDGCode = step->GetTrack()->GetDefinition()->GetPDGEncoding();
+    record.fPosition[0] = position.x() / CLHEP::mm;
+    record.fPosition[1] = position.y() / CLHEP::mm;
+    record.fPosition[2] = position.z() / CLHEP::mm;
+    record.fDirection[0] = direction.x();
+    record.fDirection[1] = direction.y();
+    record.fDirection[2] = direction.z();
+    record.fEnergy = point->GetKineticEnergy() / CLHEP::keV;
+    record.fTime = point->GetGlobalTime() / CLHEP::microsecond;
+    record.fWeight = point->GetWeight();
+
+    fPhaseSpaceRecords.push_back(record);
+}
+
+void OutputManager::RecordMaterialScanStep(const G4Step* step) {
+    const G4StepPoint* point = step->GetPreStepPoint();
+    const auto length = step->GetStepLength();
+    fMaterialScanPathLengths[point->GetPhysicalVolume()] += length / CLHEP::mm;
+    fMaterialScanArealDensities[point->GetMaterial()] +=
+        length / CLHEP::cm * point->GetMaterial()->GetDensity() / (CLHEP::g / CLHEP::cm3);
+}
+
+void OutputManager::SubmitMaterialScanRay() {
+    const auto& geometryInfo = fSimulationManager->GetRestMetadata()->GetGeant4GeometryInfo();
+
+    map<string, Double_t> pathLengths;
+    for (const auto& [volume, length] : fMaterialScanPathLengths) {
+        const TString volumeName = geometryInfo.GetAlternativeNameFromGeant4PhysicalName(volume->GetName());
+        pathLengths[volumeName.Data()] += length;
+    }
+    map<string, Double_t> arealDensities;
+    for (const auto& [material, density] : fMaterialScanArealDensities) {
+        arealDensities[material->GetName()] += density;
+    }
+
+    const auto ray = G4EventManager::GetEventManager()->GetConstCurrentEvent()->GetEventID();
+    fSimulationManager->GetMaterialScan()->AddRay(ray, pathLengths, arealDensities);
+
+    fMaterialScanPathLengths.clear();
+    fMaterialScanArealDensities.clear();
+}
+
+void OutputManager::RecordPilotStep(const G4Step* step) {
+    const G4Track* track = step->GetTrack();
+    auto& pilotTrack = fPilotTracks[track->GetTrackID()];
+    pilotTrack.fParentID = track->GetParentID();
+
+    // every cell the step goes through, long neutral steps in shields cross many of them
+    const auto importanceMap = fSimulationManager->GetImportanceMap();
+    importanceMap->AddCrossedCells(step->GetPreStepPoint()->GetPosition() / CLHEP::mm,
+                                   step->GetPostStepPoint()->GetPosition() / CLHEP::mm, pilotTrack.fCells);
+    if (step->GetTotalEnergyDeposit() > 0 && step->GetPreStepPoint()->GetSensitiveDetector() != nullptr) {
+        pilotTrack.fContributes = true;
+    }
+}
+
+void OutputManager::FillMeshTallies(const G4Step* step) {
+    const auto& start = step->GetPreStepPoint()->GetPosition();
+    const auto& end = step->GetPostStepPoint()->GetPosition();
+    const Double_t energy = step->GetTotalEnergyDeposit() / CLHEP::keV;
+    const auto particle = step->GetTrack()->GetDefinition();
+    // neutral particles only deposit at interactions (photoabsorption, capture...), at the end of the step
+    const bool charged = particle->GetPDGCharge() != 0;
+    for (auto& grid : fMeshTallyGrids) {
+        grid.Fill(start / CLHEP::mm, end / CLHEP::mm, charged ? energy : 0, charged ? 0 : energy,
+                  particle->GetParticleName());
+    }
+}
+
+void OutputManager::RecordBoundaryCrossing(const G4Step* step) {
+    const auto prePoint = step->GetPreStepPoint();
+    const auto postPoint = step->GetPostStepPoint();
+    const auto preVolume = prePoint->GetPhysicalVolume();
+    const auto postVolume = postPoint->GetPhysicalVolume();
+
+    // boundaries with the daughters of a volume are inside of it, not on its surface
+    const auto isDaughterOf = [](const G4VTouchable* touchable, const G4VPhysicalVolume* mother) {
+        return touchable->GetHistoryDepth() > 0 && touchable->GetVolume(1) == mother;
+    };
+
+    const auto& placements = fContext->fSurfaceTallyVolumes;
+    for (size_t i = 0; i < placements.size(); i++) {
+        for (const auto volume : placements[i]) {
+            // both for a boundary between two copies of the same volume
+            if (postVolume == volume && !isDaughterOf(prePoint->GetTouchable(), volume)) {
+                fSurfaceTallySpectra[i].Fill(step, true);
+            }
+            if (preVolume == volume &&
+                (postVolume == nullptr || !isDaughterOf(postPoint->GetTouchable(), volume))) {
+                fSurfaceTallySpectra[i].Fill(step, false);
+            }
+        }
+    }
+}
+
+void OutputManager::RecordIsotopeProduction(const G4Track* track) {
+    if (!ActivationTally::IsProducedIsotope(track)) {
+        return;
+    }
+    fActivationCounts.Fill(fContext->GetVolume(track->GetVolume()).fName.Data(), track);
+}
+
+void OutputManager::MergeTallies() {
+    const auto& meshTallies = fSimulationManager->GetMeshTallies();
+    for (size_t i = 0; i < fMeshTallyGrids.size(); i++) {
+        meshTallies[i]->Merge(fMeshTallyGrids[i]);
+    }
+    fMeshTallyGrids.clear();
+
+    const auto& surfaceTallies = fSimulationManager->GetSurfaceTallies();
+    for (size_t i = 0; i < fSurfaceTallySpectra.size(); i++) {
+        surfaceTallies[i]->Merge(fSurfaceTallySpectra[i]);
+    }
+    fSurfaceTallySpectra.clear();
+
+    if (fSimulationManager->GetActivationTally() != nullptr) {
+        fSimulationManager->GetActivationTally()->Merge(fActivationCounts);
+    }
+    fActivationCounts = {};
+}
+
+void OutputManager::SubmitPilotEvent() {
+    // a track contributes if any of its descendants does
+    for (const auto& [trackID, pilotTrack] : fPilotTracks) {
+        if (!pilotTrack.fContributes) {
+            continue;
+        }
+        auto parent = fPilotTracks.find(pilotTrack.fParentID);
+        while (parent != fPilotTracks.end() && !parent->second.fContributes) {
+            parent->second.fContributes = true;
+            parent = fPilotTracks.find(parent->second.fParentID);
+        }
+    }
+
+    unordered_map<Int_t, Double_t> population;
+    unordered_map<Int_t, Double_t> contribution;
+    for (auto& [trackID, pilotTrack] : fPilotTracks) {
+        // each track counts once per cell even if it goes back and forth
+        auto& cells = pilotTrack.fCells;
+        sort(cells.begin(), cells.end());
+        cells.erase(unique(cells.begin(), cells.end()), cells.end());
+        for (const auto cell : cells) {
+            population[cell]++;
+            if (pilotTrack.fContributes) {
+                contribution[cell]++;
+            }
+        }
+    }
+
+    fSimulationManager->GetImportanceMap()->AddEvent(population, contribution);
+    fPilotTracks.clear();
+}
 
 void OutputManager::AddSensitiveEnergy(Double_t energy, const char* physicalVolumeName) {
     fEvent->AddEnergyToSensitiveVolume(energy);
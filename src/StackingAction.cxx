@@ -3,11 +3,13 @@
 
 #include <G4ParticleTable.hh>
 #include <G4ParticleTypes.hh>
+#include <G4PrimaryParticle.hh>
 #include <G4SystemOfUnits.hh>
 #include <G4Track.hh>
 #include <G4UnitsTable.hh>
 #include <G4VProcess.hh>
 
+#include "DecayLibrary.h"
 #include "SimulationManager.h"
 
 StackingAction::StackingAction(SimulationManager* simulationManager) : fSimulationManager(simulationManager) {
@@ -25,14 +27,39 @@ StackingAction::StackingAction(SimulationManager* simulationManager) : fSimulati
 }
 
 G4ClassificationOfNewTrack StackingAction::ClassifyNewTrack(const G4Track* track) {
+    const auto classification = Classify(track);
+    if (classification == fKill && track->GetParentID() > 0) {
+        const auto outputManager = fSimulationManager->GetOutputManager();
+        if (outputManager->GetContext().fStreamingTrackRemoval) {
+            // the secondary will never be tracked, it no longer holds the release of its parent
+            outputManager->ResolveKilledSecondary(track->GetParentID());
+        }
+    }
+    return classification;
+}
+
+G4ClassificationOfNewTrack StackingAction::Classify(const G4Track* track) {
     const G4ClassificationOfNewTrack decayClassification =
         fSimulationManager->GetRestMetadata()->isFullChainActivated() ? fWaiting : fKill;
+    auto particle = track->GetParticleDefinition();
+
     if (track->GetParentID() <= 0) {
+        const auto primary = track->GetDynamicParticle()->GetPrimaryParticle();
+        if (primary != nullptr &&
+            dynamic_cast<DecayLibraryDaughterInformation*>(primary->GetUserInformation()) != nullptr &&
+            !particle->GetPDGStable() && particle->GetPDGLifeTime() > fMaxAllowedLifetime) {
+            // daughter of a decay sampled from the decay library, same treatment as a decay product
+            return decayClassification;
+        }
         // always process the first track regardless
         return fUrgent;
     }
 
-    auto particle = track->GetParticleDefinition();
+    const auto outputManager = fSimulationManager->GetOutputManager();
+    if (outputManager->GetContext().fActivationTally) {
+        outputManager->RecordIsotopeProduction(track);
+    }
+
     if (fParticlesToIgnore.find(particle) != fParticlesToIgnore.end()) {
         // ignore this track
         return fKill;
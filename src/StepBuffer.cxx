@@ -0,0 +1,78 @@
+
+#include "StepBuffer.h"
+
+#include <CLHEP/Units/SystemOfUnits.h>
+
+using namespace std;
+
+namespace {
+void Scale(vector<Double_t>& column, Double_t factor) {
+    // simple loop over contiguous memory so the compiler can vectorize it
+    Double_t* values = column.data();
+    const size_t size = column.size();
+    for (size_t i = 0; i < size; i++) {
+        values[i] *= factor;
+    }
+}
+
+template <typename T>
+void Compact(vector<T>& column, const vector<bool>& keep, size_t size) {
+    if (column.empty()) {
+        return;  // optional field not stored
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < keep.size(); i++) {
+        if (keep[i]) {
+            column[kept++] = column[i];
+        }
+    }
+    column.resize(size);
+}
+}  // namespace
+
+void StepBuffer::ConvertUnits() {
+    Scale(fX, 1 / CLHEP::mm);
+    Scale(fY, 1 / CLHEP::mm);
+    Scale(fZ, 1 / CLHEP::mm);
+    Scale(fEnergy, 1 / CLHEP::keV);
+    Scale(fTime, 1 / CLHEP::microsecond);
+    Scale(fKineticEnergy, 1 / CLHEP::keV);
+}
+
+void StepBuffer::RemoveTracks(const unordered_set<Int_t>& trackIDs) {
+    vector<bool> keep(Size());
+    size_t size = 0;
+    for (size_t i = 0; i < keep.size(); i++) {
+        keep[i] = trackIDs.count(fTrackID[i]) == 0;
+        size += keep[i];
+    }
+    // capacity is kept, it is reused by the steps still to come
+    Compact(fTrackID, keep, size);
+    Compact(fX, keep, size);
+    Compact(fY, keep, size);
+    Compact(fZ, keep, size);
+    Compact(fEnergy, keep, size);
+    Compact(fTime, keep, size);
+    Compact(fProcessID, keep, size);
+    Compact(fVolumeID, keep, size);
+    Compact(fKineticEnergy, keep, size);
+    Compact(fDirectionX, keep, size);
+    Compact(fDirectionY, keep, size);
+    Compact(fDirectionZ, keep, size);
+}
+
+void StepBuffer::Clear() {
+    // capacity is kept for the next event
+    fTrackID.clear();
+    fX.clear();
+    fY.clear();
+    fZ.clear();
+    fEnergy.clear();
+    fTime.clear();
+    fProcessID.clear();
+    fVolumeID.clear();
+    fKineticEnergy.clear();
+    fDirectionX.clear();
+    fDirectionY.clear();
+    fDirectionZ.clear();
+}
@@ -11,17 +11,70 @@
 #include <G4SteppingManager.hh>
 #include <G4SystemOfUnits.hh>
 #include <G4UnitsTable.hh>
+#include <G4VTouchable.hh>
 #include <globals.hh>
 
+#include "DetectorConstruction.h"
 #include "SimulationManager.h"
 
 using namespace std;
 
 SteppingAction::SteppingAction(SimulationManager* simulationManager)
-    : fSimulationManager(simulationManager) {}
+    : fSimulationManager(simulationManager), fOutputManager(simulationManager->GetOutputManager()) {}
 
 SteppingAction::~SteppingAction() {}
 
+bool SteppingAction::IsInsidePhaseSpaceVolume(const G4StepPoint* point) const {
+    // leaving one of its daughters also ends the step on the phase space volume
+    const G4VTouchable* touchable = point->GetTouchable();
+    for (int depth = 0; depth <= touchable->GetHistoryDepth(); depth++) {
+        if (touchable->GetVolume(depth) == fPhaseSpaceVolume) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void SteppingAction::UserSteppingAction(const G4Step* step) {
-    fSimulationManager->GetOutputManager()->RecordStep(step);
+    const auto outputManager = fOutputManager;
+    if (outputManager->GetContext().fMaterialScan) {
+        outputManager->RecordMaterialScanStep(step);
+        return;
+    }
+    outputManager->RecordStep(step);
+    if (outputManager->GetContext().fPilot) {
+        outputManager->RecordPilotStep(step);
+    }
+    if (outputManager->GetContext().fMeshTallies) {
+        outputManager->FillMeshTallies(step);
+    }
+    if (!outputManager->GetContext().fSurfaceTallyVolumes.empty() &&
+        step->GetPostStepPoint()->GetStepStatus() == fGeomBoundary) {
+        outputManager->RecordBoundaryCrossing(step);
+    }
+
+    if (!fPhaseSpaceVolumeResolved) {
+        fPhaseSpaceVolumeResolved = true;
+        const auto& volumeName = fSimulationManager->GetPhaseSpaceVolume();
+        if (!volumeName.empty()) {
+            auto detector =
+                (DetectorConstruction*)G4RunManager::GetRunManager()->GetUserDetectorConstruction();
+            fPhaseSpaceVolume = detector->GetPhysicalVolume(volumeName);
+            if (fPhaseSpaceVolume == nullptr) {
+                cerr << "SteppingAction - Phase space volume '" << volumeName << "' not found in geometry"
+                     << endl;
+                exit(1);
+            }
+        }
+    }
+
+    if (fPhaseSpaceVolume != nullptr && step->GetPostStepPoint()->GetStepStatus() == fGeomBoundary &&
+        step->GetPostStepPoint()->GetPhysicalVolume() == fPhaseSpaceVolume &&
+        !IsInsidePhaseSpaceVolume(step->GetPreStepPoint())) {
+        // particle is entering the phase space volume
+        outputManager->RecordPhaseSpace(step);
+        if (fSimulationManager->GetPhaseSpaceKill()) {
+            step->GetTrack()->SetTrackStatus(fStopAndKill);
+        }
+    }
 }
@@ -22,8 +22,12 @@ SteppingVerbose::SteppingVerbose(SimulationManager* simulationManager)
 SteppingVerbose::~SteppingVerbose() {}
 
 void SteppingVerbose::TrackingStarted() {
+    const auto outputManager = fSimulationManager->GetOutputManager();
+    if (outputManager->GetContext().fMaterialScan) {
+        return;
+    }
     CopyState();
-    fSimulationManager->GetOutputManager()->RecordStep(fStep);
+    outputManager->RecordStep(fStep);
 }
 
 void SteppingVerbose::StepInfo() {}
@@ -0,0 +1,119 @@
+
+#include "SurfaceTally.h"
+
+#include <TDirectory.h>
+#include <TH2D.h>
+#include <TString.h>
+
+#include <G4NavigationHistory.hh>
+#include <G4Step.hh>
+#include <G4SystemOfUnits.hh>
+#include <G4VSolid.hh>
+#include <G4VTouchable.hh>
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+
+SurfaceTally::SurfaceTally(const Parameters& parameters) : fParameters(parameters) {
+    if (fParameters.fEnergyBins <= 0 || fParameters.fAngleBins <= 0) {
+        cerr << "SurfaceTally - '" << fParameters.fVolume
+             << "' number of energy and angle bins must be positive" << endl;
+        exit(1);
+    }
+    if (fParameters.fEnergyRange.Y() <= fParameters.fEnergyRange.X() ||
+        (fParameters.fLogEnergy && fParameters.fEnergyRange.X() <= 0)) {
+        cerr << "SurfaceTally - '" << fParameters.fVolume << "' energy range is invalid" << endl;
+        exit(1);
+    }
+}
+
+void SurfaceTally::Spectra::Fill(const G4Step* step, bool entering) {
+    const auto& parameters = fTally.fParameters;
+
+    const G4StepPoint* point = step->GetPostStepPoint();
+    const Double_t energy = point->GetKineticEnergy() / keV;
+    Double_t energyFraction;
+    if (parameters.fLogEnergy) {
+        energyFraction = log(energy / parameters.fEnergyRange.X()) /
+                         log(parameters.fEnergyRange.Y() / parameters.fEnergyRange.X());
+    } else {
+        energyFraction = (energy - parameters.fEnergyRange.X()) /
+                         (parameters.fEnergyRange.Y() - parameters.fEnergyRange.X());
+    }
+    if (!(energyFraction >= 0 && energyFraction < 1)) {
+        return;
+    }
+
+    // outward normal of the volume at the crossing point, from the side that is inside the volume
+    const G4VTouchable* touchable =
+        entering ? point->GetTouchable() : step->GetPreStepPoint()->GetTouchable();
+    const G4AffineTransform& toLocal = touchable->GetHistory()->GetTopTransform();
+    const G4ThreeVector localNormal =
+        touchable->GetSolid()->SurfaceNormal(toLocal.TransformPoint(point->GetPosition()));
+    const G4ThreeVector normal = toLocal.Inverse().TransformAxis(localNormal);
+    const Double_t cosine = max(-1.0, min(1.0, point->GetMomentumDirection().dot(normal)));
+
+    const Int_t energyBin = Int_t(energyFraction * parameters.fEnergyBins);
+    const Int_t angleBin = min(Int_t((cosine + 1) / 2 * parameters.fAngleBins), parameters.fAngleBins - 1);
+
+    auto& counts = fCounts[step->GetTrack()->GetDefinition()];
+    if (counts.empty()) {
+        counts.resize(size_t(parameters.fEnergyBins) * parameters.fAngleBins, 0);
+    }
+    counts[size_t(angleBin) * parameters.fEnergyBins + energyBin] += step->GetTrack()->GetWeight();
+}
+
+void SurfaceTally::Merge(const Spectra& spectra) {
+    lock_guard<mutex> guard(fMutex);
+    for (const auto& [particle, counts] : spectra.fCounts) {
+        auto& mergedCounts = fCounts[particle->GetParticleName()];
+        if (mergedCounts.empty()) {
+            mergedCounts.resize(counts.size(), 0);
+        }
+        for (size_t bin = 0; bin < counts.size(); bin++) {
+            mergedCounts[bin] += counts[bin];
+        }
+    }
+}
+
+void SurfaceTally::Write() {
+    lock_guard<mutex> guard(fMutex);
+
+    TDirectory* previousDirectory = gDirectory;
+    gDirectory->mkdir("SurfaceTallies", "", true)->mkdir(fParameters.fVolume.c_str(), "", true)->cd();
+
+    const auto& p = fParameters;
+    vector<Double_t> energyEdges(p.fEnergyBins + 1);
+    for (Int_t i = 0; i <= p.fEnergyBins; i++) {
+        const Double_t fraction = Double_t(i) / p.fEnergyBins;
+        energyEdges[i] = p.fLogEnergy
+                             ? p.fEnergyRange.X() * pow(p.fEnergyRange.Y() / p.fEnergyRange.X(), fraction)
+                             : p.fEnergyRange.X() + fraction * (p.fEnergyRange.Y() - p.fEnergyRange.X());
+    }
+
+    for (const auto& [particle, counts] : fCounts) {
+        const string title = "Crossings of the " + p.fVolume + " surface by " + particle;
+        TH2D histogram(particle.c_str(), title.c_str(), p.fEnergyBins, energyEdges.data(), p.fAngleBins, -1,
+                       1);
+        histogram.SetDirectory(nullptr);
+        histogram.GetXaxis()->SetTitle("Kinetic energy (keV)");
+        histogram.GetYaxis()->SetTitle("cos(angle to outward normal)");
+        for (Int_t angleBin = 0; angleBin < p.fAngleBins; angleBin++) {
+            for (Int_t energyBin = 0; energyBin < p.fEnergyBins; energyBin++) {
+                histogram.SetBinContent(energyBin + 1, angleBin + 1,
+                                        counts[size_t(angleBin) * p.fEnergyBins + energyBin]);
+            }
+        }
+        histogram.Write(particle.c_str(), TObject::kOverwrite);
+    }
+    previousDirectory->cd();
+}
+
+string SurfaceTally::ToString() const {
+    const auto& p = fParameters;
+    return TString::Format("volume=%s energyBins=%d energyRange=(%g,%g)keV logEnergy=%s angleBins=%d",
+                           p.fVolume.c_str(), p.fEnergyBins, p.fEnergyRange.X(), p.fEnergyRange.Y(),
+                           p.fLogEnergy ? "true" : "false", p.fAngleBins)
+        .Data();
+}
@@ -0,0 +1,69 @@
+
+#include "ThreadContext.h"
+
+#include <G4PhysicalVolumeStore.hh>
+#include <G4VPhysicalVolume.hh>
+#include <iostream>
+
+#include "SimulationManager.h"
+
+using namespace std;
+
+ThreadContext::ThreadContext(const SimulationManager* simulationManager, OutputManager* outputManager)
+    : fOutputManager(outputManager), fVoxelizer(outputManager->GetVoxelizer()) {
+    const auto metadata = simulationManager->GetRestMetadata();
+
+    fHitFields = simulationManager->GetHitFields();
+    fRemoveZeroEnergyHits = simulationManager->GetRemoveZeroEnergyHits();
+    fMaterialScan = simulationManager->GetMaterialScan() != nullptr;
+    fPilot = simulationManager->GetImportanceMap() != nullptr;
+    fMeshTallies = !simulationManager->GetMeshTallies().empty();
+    fActivationTally = simulationManager->GetActivationTally() != nullptr;
+
+    fSaveAllEvents = metadata->GetSaveAllEvents();
+    fRemoveUnwantedTracks = metadata->GetRemoveUnwantedTracks();
+    fKeepZeroEnergyTracks = metadata->GetRemoveUnwantedTracksKeepZeroEnergyTracks();
+    // electron drift needs the hits of all the tracks
+    fStreamingTrackRemoval =
+        fRemoveUnwantedTracks && !fMaterialScan && simulationManager->GetElectronDrift() == nullptr;
+    fMinimumEnergyStored = metadata->GetMinimumEnergyStored();
+    fMaximumEnergyStored = metadata->GetMaximumEnergyStored();
+    fSimulationMaxTimeSeconds = metadata->GetSimulationMaxTimeSeconds();
+
+    // replaces the lookups by name of every step
+    const auto& geometryInfo = metadata->GetGeant4GeometryInfo();
+    for (const auto& physicalVolume : *G4PhysicalVolumeStore::GetInstance()) {
+        Volume volume;
+        volume.fName = geometryInfo.GetAlternativeNameFromGeant4PhysicalName(physicalVolume->GetName());
+        volume.fID = geometryInfo.GetIDFromVolume(volume.fName);
+        volume.fActive = metadata->IsActiveVolume(volume.fName);
+        volume.fKeepTracks = metadata->IsKeepTracksVolume(volume.fName);
+        fVolumes[physicalVolume] = volume;
+    }
+
+    for (const auto& surfaceTally : simulationManager->GetSurfaceTallies()) {
+        // every placement sharing the name of the tally volume
+        vector<const G4VPhysicalVolume*> placements;
+        for (const auto& [physicalVolume, volume] : fVolumes) {
+            if (volume.fName == surfaceTally->GetVolume()) {
+                placements.push_back(physicalVolume);
+            }
+        }
+        if (placements.empty()) {
+            cerr << "ThreadContext - surface tally volume '" << surfaceTally->GetVolume()
+                 << "' not found in the geometry" << endl;
+            exit(1);
+        }
+        fSurfaceTallyVolumes.push_back(placements);
+    }
+}
+
+const ThreadContext::Volume& ThreadContext::GetVolume(const G4VPhysicalVolume* volume) const {
+    const auto it = fVolumes.find(volume);
+    if (it == fVolumes.end()) {
+        cerr << "ThreadContext - physical volume '" << volume->GetName() << "' was not in the geometry when "
+             << "the thread started" << endl;
+        exit(1);
+    }
+    return it->second;
+}
@@ -6,6 +6,7 @@
 #include <G4RunManager.hh>
 #include <G4SystemOfUnits.hh>
 #include <G4Track.hh>
+#include <G4TrackingManager.hh>
 #include <G4UnitsTable.hh>
 
 #include "SimulationManager.h"
@@ -13,14 +14,25 @@
 using namespace std;
 
 TrackingAction::TrackingAction(SimulationManager* simulationManager)
-    : G4UserTrackingAction(), fSimulationManager(simulationManager) {}
+    : G4UserTrackingAction(),
+      fSimulationManager(simulationManager),
+      fOutputManager(simulationManager->GetOutputManager()) {}
 
 TrackingAction::~TrackingAction() {}
 
 void TrackingAction::PreUserTrackingAction(const G4Track* track) {
-    fSimulationManager->GetOutputManager()->RecordTrack(track);
+    if (fOutputManager->GetContext().fMaterialScan) {
+        return;
+    }
+    fOutputManager->RecordTrack(track);
 }
 
 void TrackingAction::PostUserTrackingAction(const G4Track* track) {
-    fSimulationManager->GetOutputManager()->UpdateTrack(track);
+    if (fOutputManager->GetContext().fMaterialScan) {
+        return;
+    }
+    fOutputManager->UpdateTrack(track);
+    if (fOutputManager->GetContext().fStreamingTrackRemoval) {
+        fOutputManager->FinishTrackLineage(track, fpTrackingManager->GimmeSecondaries()->size());
+    }
 }
@@ -1,11 +1,18 @@
 
 #include <Application.h>
+#include <TDirectory.h>
 #include <TGeoManager.h>
+#include <TH2D.h>
+#include <TH3D.h>
+#include <TNamed.h>
 #include <TROOT.h>
 #include <TRestRun.h>
+#include <TTree.h>
 #include <gtest/gtest.h>
 
 #include <filesystem>
+#include <fstream>
+#include <sstream>
 
 namespace fs = std::filesystem;
 
@@ -13,6 +20,120 @@ using namespace std;
 
 const auto examplesPath = fs::path(__FILE__).parent_path().parent_path().parent_path() / "examples";
 
+// Runs a copy of an example in a temporary directory, with some of the text of its RML replaced.
+// 'outputFile' is only set when the simulation ran, call it inside 'ASSERT_NO_FATAL_FAILURE'
+void RunModifiedExample(const string& example, const string& rmlFile, const string& name,
+                        const vector<pair<string, string>>& replacements, int nEvents, fs::path& outputFile) {
+    const auto runPath = fs::temp_directory_path() / "restG4_examples" / name;
+    fs::remove_all(runPath);
+    fs::create_directories(runPath);
+    fs::copy(examplesPath / example, runPath, fs::copy_options::recursive);
+
+    ifstream input(runPath / rmlFile);
+    ASSERT_TRUE(input.is_open()) << "Unable to read " << rmlFile << " of example " << example;
+    stringstream buffer;
+    buffer << input.rdbuf();
+    string rml = buffer.str();
+    for (const auto& [text, replacement] : replacements) {
+        const auto position = rml.find(text);
+        if (position == string::npos) {
+            FAIL() << "Text '" << text << "' not found in " << rmlFile;
+        }
+        rml.replace(position, text.size(), replacement);
+    }
+    const string modifiedRmlFile = name + ".rml";
+    {
+        ofstream output(runPath / modifiedRmlFile);
+        output << rml;
+    }
+
+    const auto originalPath = fs::current_path();
+    fs::current_path(runPath);
+
+    CommandLineOptions::Options options;
+    options.rmlFile = modifiedRmlFile;
+    options.outputFile = runPath / (name + ".root");
+    options.nEvents = nEvents;
+
+    {
+        Application app;
+        app.Run(options);
+    }
+
+    fs::current_path(originalPath);
+    outputFile = options.outputFile;
+}
+
+// 'NLDBD.rml' with fewer events and no option changed, reference for the options that must not change results
+void RunNLDBDReference(fs::path& referenceFile) {
+    static fs::path file;
+    if (file.empty()) {
+        RunModifiedExample("01.NLDBD", "NLDBD.rml", "NLDBD_reference", {}, 10, file);
+    }
+    referenceFile = file;
+}
+
+// adds parameters to the 'TRestGeant4Metadata' section of 'NLDBD.rml'
+pair<string, string> NLDBDParameters(const string& parameters) {
+    return {"    </TRestGeant4Metadata>", parameters + "\n\n    </TRestGeant4Metadata>"};
+}
+
+Double_t GetHitsEnergy(const TRestGeant4Event& event) {
+    Double_t energy = 0;
+    for (size_t t = 0; t < event.GetNumberOfTracks(); t++) {
+        const auto& hits = event.GetTrack(t).GetHits();
+        for (size_t h = 0; h < hits.GetNumberOfHits(); h++) {
+            energy += hits.GetEnergy(h);
+        }
+    }
+    return energy;
+}
+
+// Same events and energies as the reference. Every track of 'file' must have the same hits as in the
+// reference, 'sameTracks' also requires that no track is missing
+void ExpectSameEvents(const fs::path& referenceFile, const fs::path& file, bool sameTracks) {
+    TRestRun referenceRun(referenceFile);
+    TRestRun run(file);
+    ASSERT_EQ(run.GetEntries(), referenceRun.GetEntries());
+    ASSERT_GT(run.GetEntries(), 0);
+
+    auto referenceEvent = referenceRun.GetInputEvent<TRestGeant4Event>();
+    auto event = run.GetInputEvent<TRestGeant4Event>();
+    for (int i = 0; i < run.GetEntries(); i++) {
+        referenceRun.GetEntry(i);
+        run.GetEntry(i);
+
+        EXPECT_EQ(event->GetID(), referenceEvent->GetID());
+        EXPECT_EQ(event->GetSubID(), referenceEvent->GetSubID());
+        EXPECT_EQ(event->GetSensitiveVolumeEnergy(), referenceEvent->GetSensitiveVolumeEnergy());
+        const Double_t referenceTotalEnergy = referenceEvent->GetTotalDepositedEnergy();
+        EXPECT_NEAR(event->GetTotalDepositedEnergy(), referenceTotalEnergy, 1E-9 * referenceTotalEnergy);
+        if (sameTracks) {
+            EXPECT_EQ(event->GetNumberOfTracks(), referenceEvent->GetNumberOfTracks());
+        }
+
+        for (size_t t = 0; t < event->GetNumberOfTracks(); t++) {
+            const auto& track = event->GetTrack(t);
+            const auto referenceTrack = referenceEvent->GetTrackByID(track.GetTrackID());
+            ASSERT_NE(referenceTrack, nullptr);
+            EXPECT_EQ(track.GetParticleName(), referenceTrack->GetParticleName());
+
+            const auto& hits = track.GetHits();
+            const auto& referenceHits = referenceTrack->GetHits();
+            ASSERT_EQ(hits.GetNumberOfHits(), referenceHits.GetNumberOfHits());
+            for (size_t h = 0; h < hits.GetNumberOfHits(); h++) {
+                EXPECT_EQ(hits.GetX(h), referenceHits.GetX(h));
+                EXPECT_EQ(hits.GetY(h), referenceHits.GetY(h));
+                EXPECT_EQ(hits.GetZ(h), referenceHits.GetZ(h));
+                EXPECT_EQ(hits.GetEnergy(h), referenceHits.GetEnergy(h));
+                EXPECT_EQ(hits.GetTime(h), referenceHits.GetTime(h));
+                EXPECT_EQ(hits.GetVolumeId(h), referenceHits.GetVolumeId(h));
+                EXPECT_EQ(hits.GetProcess(h), referenceHits.GetProcess(h));
+            }
+        }
+    }
+}
+
 TEST(restG4, CheckExampleFiles) {
     cout << "Examples files path: " << examplesPath << endl;
 
@@ -138,6 +259,198 @@ TEST(restG4, Metadata) {
     EXPECT_EQ(processes.count("compt") > 0, true);
 }
 
+TEST(restG4, Example_01_NLDBD_HitFields) {
+    fs::path referenceFile, file;
+    ASSERT_NO_FATAL_FAILURE(RunNLDBDReference(referenceFile));
+    ASSERT_NO_FATAL_FAILURE(RunModifiedExample("01.NLDBD", "NLDBD.rml", "NLDBD_hitFields",
+                                               {NLDBDParameters(R"(
+        <parameter name="hitFields" value="time"/>)")},
+                                               10, file));
+
+    // the stored columns are the same, only the optional ones are dropped
+    ExpectSameEvents(referenceFile, file, true);
+
+    TRestRun run(file);
+    const auto hitFields = run.GetInputFile()->Get<TNamed>("Geant4HitFields");
+    ASSERT_NE(hitFields, nullptr);
+    EXPECT_EQ(string(hitFields->GetTitle()), "position,energy,processID,volumeID,time");
+
+    // the dropped columns hold one placeholder per hit, so their accessors are safe
+    auto event = run.GetInputEvent<TRestGeant4Event>();
+    for (int i = 0; i < run.GetEntries(); i++) {
+        run.GetEntry(i);
+        for (size_t t = 0; t < event->GetNumberOfTracks(); t++) {
+            const auto& hits = event->GetTrack(t).GetHits();
+            for (size_t h = 0; h < hits.GetNumberOfHits(); h++) {
+                EXPECT_EQ(hits.GetKineticEnergy(h), -1);
+                EXPECT_EQ(hits.GetMomentumDirection(h), TVector3(0, 0, 0));
+            }
+        }
+    }
+
+    TRestRun referenceRun(referenceFile);
+    const auto referenceHitFields = referenceRun.GetInputFile()->Get<TNamed>("Geant4HitFields");
+    ASSERT_NE(referenceHitFields, nullptr);
+    EXPECT_EQ(string(referenceHitFields->GetTitle()),
+              "position,energy,processID,volumeID,time,kineticEnergy,momentumDirection");
+}
+
+TEST(restG4, Example_01_NLDBD_Voxelization) {
+    const string parameters = R"(
+        <parameter name="voxelization" value="true"/>
+        <parameter name="voxelSize" value="(5,5,5)" units="mm"/>)";
+    fs::path referenceFile, file;
+    ASSERT_NO_FATAL_FAILURE(RunNLDBDReference(referenceFile));
+    ASSERT_NO_FATAL_FAILURE(RunModifiedExample("01.NLDBD", "NLDBD.rml", "NLDBD_voxelization",
+                                               {NLDBDParameters(parameters)}, 10, file));
+
+    TRestRun referenceRun(referenceFile);
+    TRestRun run(file);
+    ASSERT_EQ(run.GetEntries(), referenceRun.GetEntries());
+
+    auto voxelTree = run.GetInputFile()->Get<TTree>("VoxelTree");
+    ASSERT_NE(voxelTree, nullptr);
+    ASSERT_EQ(voxelTree->GetEntries(), referenceRun.GetEntries());
+
+    Int_t eventID;
+    vector<Float_t>* voxelEnergy = nullptr;
+    voxelTree->SetBranchAddress("eventID", &eventID);
+    voxelTree->SetBranchAddress("voxelEnergy", &voxelEnergy);
+
+    // the energy of the hits is moved to the voxels
+    auto referenceEvent = referenceRun.GetInputEvent<TRestGeant4Event>();
+    for (int i = 0; i < referenceRun.GetEntries(); i++) {
+        referenceRun.GetEntry(i);
+        voxelTree->GetEntry(i);
+        EXPECT_EQ(eventID, referenceEvent->GetID());
+        Double_t energy = 0;
+        for (const auto value : *voxelEnergy) {
+            energy += value;
+        }
+        const Double_t referenceEnergy = GetHitsEnergy(*referenceEvent);
+        EXPECT_NEAR(energy, referenceEnergy, 1E-4 * referenceEnergy);
+    }
+}
+
+TEST(restG4, Example_01_NLDBD_MeshTally) {
+    // with every volume active the hits hold all the deposited energy, which the mesh must also hold. The
+    // sensitive energy of a double beta decay is always within 'energyRange', so every event is stored
+    const string parameters = R"(
+        <parameter name="meshTallies" value="world"/>
+        <parameter name="worldMeshMinimum" value="(-11,-11,-11)" units="m"/>
+        <parameter name="worldMeshMaximum" value="(11,11,11)" units="m"/>)";
+    fs::path file;
+    ASSERT_NO_FATAL_FAILURE(RunModifiedExample(
+        "01.NLDBD", "NLDBD.rml", "NLDBD_meshTally",
+        {NLDBDParameters(parameters),
+         {R"(<parameter name="activateAllVolumes" value="false"/>)",
+          R"(<parameter name="activateAllVolumes" value="true"/>)"}},
+        10, file));
+
+    TRestRun run(file);
+    ASSERT_GT(run.GetEntries(), 0);
+    Double_t hitsEnergy = 0;
+    auto event = run.GetInputEvent<TRestGeant4Event>();
+    for (int i = 0; i < run.GetEntries(); i++) {
+        run.GetEntry(i);
+        hitsEnergy += GetHitsEnergy(*event);
+    }
+    ASSERT_GT(hitsEnergy, 0);
+
+    const auto meshEnergy = run.GetInputFile()->Get<TH3D>("MeshTallies/world_Energy");
+    ASSERT_NE(meshEnergy, nullptr);
+    EXPECT_NEAR(meshEnergy->Integral(), hitsEnergy, 1E-4 * hitsEnergy);
+}
+
+TEST(restG4, Example_01_NLDBD_SurfaceTally) {
+    // geantinos from the centre of the gas along +Z leave it once, through the cap, along the outward normal
+    fs::path file;
+    ASSERT_NO_FATAL_FAILURE(RunModifiedExample(
+        "01.NLDBD", "NLDBD.rml", "NLDBD_surfaceTally",
+        {NLDBDParameters(R"(
+        <parameter name="surfaceTallies" value="gas"/>)"),
+         {R"(<generator type="volume" from="gas">)",
+          R"(<generator type="point" position="(0,0,0)" units="mm">)"},
+         {R"(<source use="Xe136bb0n.dat"/>)", R"(<source particle="geantino">
+                <angular type="flux" direction="(0,0,1)"/>
+                <energy type="mono" energy="1000" units="keV"/>
+            </source>)"}},
+        10, file));
+
+    TRestRun run(file);
+    const auto crossings = run.GetInputFile()->Get<TH2D>("SurfaceTallies/gas/geantino");
+    ASSERT_NE(crossings, nullptr);
+    EXPECT_EQ(crossings->Integral(), 10);
+
+    // cosine 1 is in the last angle bin, the energy is unchanged
+    const Int_t lastAngleBin = crossings->GetNbinsY();
+    EXPECT_EQ(crossings->Integral(1, crossings->GetNbinsX(), lastAngleBin, lastAngleBin), 10);
+    const Int_t firstEnergyBin = crossings->GetXaxis()->FindBin(990);
+    const Int_t lastEnergyBin = crossings->GetXaxis()->FindBin(1010);
+    EXPECT_EQ(crossings->Integral(firstEnergyBin, lastEnergyBin, 1, lastAngleBin), 10);
+}
+
+TEST(restG4, Example_01_NLDBD_ActivationTally) {
+    // thermal neutrons deep in the water tank are all captured there, each capture produces one nucleus
+    // (deuterium, or rarely oxygen 17). The neutron tracking cut would kill them before the capture
+    fs::path file;
+    ASSERT_NO_FATAL_FAILURE(RunModifiedExample(
+        "01.NLDBD", "NLDBD.rml", "NLDBD_activationTally",
+        {NLDBDParameters(R"(
+        <parameter name="activationTally" value="true"/>)"),
+         {R"(<generator type="volume" from="gas">)",
+          R"(<generator type="point" position="(2500,0,0)" units="mm">)"},
+         {R"(<source use="Xe136bb0n.dat"/>)", R"(<source particle="neutron">
+                <angular type="isotropic"/>
+                <energy type="mono" energy="2.5E-5" units="keV"/>
+            </source>)"},
+         {R"(<physicsList name="G4NeutronTrackingCut"/>)", ""}},
+        10, file));
+
+    TRestRun run(file);
+    auto isotopes = run.GetInputFile()->Get<TTree>("ActivationTally/Isotopes");
+    ASSERT_NE(isotopes, nullptr);
+    ASSERT_GT(isotopes->GetEntries(), 0);
+
+    string* volume = nullptr;
+    Long64_t count;
+    isotopes->SetBranchAddress("volume", &volume);
+    isotopes->SetBranchAddress("count", &count);
+    Long64_t totalCount = 0;
+    for (Long64_t i = 0; i < isotopes->GetEntries(); i++) {
+        isotopes->GetEntry(i);
+        EXPECT_EQ(*volume, "waterTank");
+        totalCount += count;
+    }
+    EXPECT_EQ(totalCount, 10);
+}
+
+TEST(restG4, Example_01_NLDBD_RemoveUnwantedTracks) {
+    // tracks are released while the event is tracked, those depositing energy in the gas must survive
+    fs::path referenceFile, file;
+    ASSERT_NO_FATAL_FAILURE(RunNLDBDReference(referenceFile));
+    ASSERT_NO_FATAL_FAILURE(RunModifiedExample(
+        "01.NLDBD", "NLDBD.rml", "NLDBD_removeUnwantedTracks",
+        {{R"(<volume name="gas" sensitive="true" maxStepSize="1mm"/>)",
+          R"(<removeUnwantedTracks enabled="true" keepZeroEnergyTracks="false"/>
+            <volume name="gas" sensitive="true" keepTracks="true" maxStepSize="1mm"/>)"}},
+        10, file));
+
+    ExpectSameEvents(referenceFile, file, false);
+
+    TRestRun referenceRun(referenceFile);
+    TRestRun run(file);
+    auto referenceEvent = referenceRun.GetInputEvent<TRestGeant4Event>();
+    auto event = run.GetInputEvent<TRestGeant4Event>();
+    for (int i = 0; i < run.GetEntries(); i++) {
+        referenceRun.GetEntry(i);
+        run.GetEntry(i);
+        EXPECT_LE(event->GetNumberOfTracks(), referenceEvent->GetNumberOfTracks());
+        const Double_t referenceEnergy = GetHitsEnergy(*referenceEvent);
+        EXPECT_NEAR(GetHitsEnergy(*event), referenceEnergy, 1E-9 * referenceEnergy);
+    }
+}
+
 TEST(restG4, Example_04_Muons) {
     // cd into example
     const auto originalPath = fs::current_path();
@@ -0,0 +1,58 @@
+#include <GeometryIndex.h>
+#include <gtest/gtest.h>
+
+#include <G4Box.hh>
+#include <G4LogicalVolume.hh>
+#include <G4Navigator.hh>
+#include <G4NistManager.hh>
+#include <G4PVPlacement.hh>
+#include <G4SystemOfUnits.hh>
+
+using namespace std;
+
+TEST(restG4, GeometryIndexRotatedMother) {
+    const auto material = G4NistManager::Instance()->FindOrBuildMaterial("G4_AIR");
+
+    const auto worldLogical = new G4LogicalVolume(new G4Box("World", 1 * m, 1 * m, 1 * m), material, "World");
+    const auto world = new G4PVPlacement(nullptr, G4ThreeVector(), worldLogical, "World", nullptr, false, 0);
+
+    const auto motherLogical =
+        new G4LogicalVolume(new G4Box("Mother", 40 * cm, 40 * cm, 40 * cm), material, "Mother");
+    auto motherRotation = new G4RotationMatrix();
+    motherRotation->rotateZ(30 * deg);
+    motherRotation->rotateX(45 * deg);
+    new G4PVPlacement(motherRotation, G4ThreeVector(10 * cm, -5 * cm, 20 * cm), motherLogical, "Mother",
+                      worldLogical, false, 0);
+
+    // off-centre and rotated inside the rotated mother
+    const auto daughterLogical =
+        new G4LogicalVolume(new G4Box("Daughter", 5 * cm, 5 * cm, 5 * cm), material, "Daughter");
+    auto daughterRotation = new G4RotationMatrix();
+    daughterRotation->rotateY(60 * deg);
+    new G4PVPlacement(daughterRotation, G4ThreeVector(20 * cm, 10 * cm, -15 * cm), daughterLogical,
+                      "Daughter", motherLogical, false, 0);
+
+    const GeometryIndex index(world);
+    ASSERT_EQ(index.GetNumberOfVolumes(), 3);
+
+    G4Navigator navigator;
+    navigator.SetWorldVolume(world);
+
+    const vector<G4ThreeVector> localPoints = {
+        {0, 0, 0}, {1 * cm, 0, 0}, {0, 2 * cm, 0}, {0, 0, 3 * cm}, {-1 * cm, 2 * cm, -3 * cm}};
+    for (const auto& volume : index.GetVolumes()) {
+        // boxes are centred on their frame, so the origin of each volume is inside it
+        const G4ThreeVector origin = volume.fGlobalTransform.TransformPoint(G4ThreeVector());
+        const auto located = navigator.LocateGlobalPointAndSetup(origin, nullptr, false, true);
+        ASSERT_EQ(located, volume.fPhysicalVolume);
+
+        const G4AffineTransform localToGlobal = navigator.GetGlobalToLocalTransform().Inverse();
+        for (const auto& point : localPoints) {
+            const G4ThreeVector expected = localToGlobal.TransformPoint(point);
+            const G4ThreeVector position = volume.fGlobalTransform.TransformPoint(point);
+            EXPECT_NEAR(position.x(), expected.x(), 1E-9 * mm);
+            EXPECT_NEAR(position.y(), expected.y(), 1E-9 * mm);
+            EXPECT_NEAR(position.z(), expected.z(), 1E-9 * mm);
+        }
+    }
+}
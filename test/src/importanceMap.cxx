@@ -0,0 +1,30 @@
+#include <ImportanceMap.h>
+#include <gtest/gtest.h>
+
+#include <filesystem>
+
+using namespace std;
+
+namespace fs = std::filesystem;
+
+TEST(restG4, ImportanceMapReadBack) {
+    ImportanceMap map(TVector3(3, 1, 1), TVector3(0, 0, 0), TVector3(30, 10, 10));
+    EXPECT_TRUE(map.HasBounds());
+
+    map.AddEvent({{0, 4}, {1, 2}, {2, 1}}, {{0, 1}, {1, 1}});
+
+    const auto filename = (fs::temp_directory_path() / "restG4_ImportanceMapReadBack.root").string();
+    map.Write(filename);
+    const auto readMap = ImportanceMap::Read(filename);
+    fs::remove(filename);
+
+    EXPECT_EQ(readMap->ToString(), map.ToString());
+
+    // ratios 1/4, 1/2 and 0, normalized to the maximum; the empty cell gets the lowest importance
+    const vector<Double_t> expected = {0.5, 1, 0.5};
+    EXPECT_EQ(readMap->GetImportances(), expected);
+    EXPECT_DOUBLE_EQ(readMap->GetImportance({5, 5, 5}), 0.5);
+    EXPECT_DOUBLE_EQ(readMap->GetImportance({15, 5, 5}), 1);
+    EXPECT_DOUBLE_EQ(readMap->GetImportance({25, 5, 5}), 0.5);
+    EXPECT_DOUBLE_EQ(readMap->GetImportance({35, 5, 5}), -1);
+}